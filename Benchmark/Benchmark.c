@@ -0,0 +1,836 @@
+// Benchmark of the graph operations on generated matrices, from 10x10 up to 10000x10000.
+//
+// Windows: build the Benchmark project of the solution.
+// Linux:   gcc -O2 -I "../TP_EDA_2ªFase" -o Benchmark Benchmark.c -lpthread
+//
+// Usage: Benchmark [--sizes 10,100,1000] [--kinds random,constant,gradient] [--repeat 5] [--samples 10000]
+//                  [--seed 1] [--dir .] [--json]
+// The graph code is compiled in from Main.c, without its menu.
+#define GRAPH_NO_MAIN
+#include "Main.c"
+
+#ifdef _WIN32
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#define NULL_DEVICE "NUL"
+#else
+#include <sys/resource.h>
+#define NULL_DEVICE "/dev/null"
+#endif
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#endif
+
+// allPaths is exponential, so it is only timed when the graph has at most this many paths
+#define MAX_BENCHMARK_PATHS 1000000
+// Larger graphs are too big for the node form or for a DOT file to be worth timing
+#define MAX_NODE_VERTICES 25000000
+#define MAX_DOT_VERTICES 4000000
+#define MAX_SIZES 16
+
+#pragma region Measurement
+/// <summary>
+/// Function to get the largest amount of physical memory the process has used so far
+/// </summary>
+/// <returns>Peak resident set size in KiB</returns>
+static long long peakRssKiB(void)
+{
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS pmc;
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) return 0;
+    return (long long)(pmc.PeakWorkingSetSize / 1024);
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+    return usage.ru_maxrss; // Already in KiB on Linux
+#endif
+}
+
+/// <summary>
+/// Function to get the number of cache misses of the process so far, from the hardware counters of the processor
+/// </summary>
+/// <returns>The count, or -1 where the counters cannot be read (other systems than Linux, virtual machines without
+/// them, or no permission)</returns>
+static long long cacheMisses(void)
+{
+#ifdef __linux__
+    static int counter = -2;
+    if (counter == -2)
+    {
+        // Only user space is counted, including the threads started after the counter
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = PERF_COUNT_HW_CACHE_MISSES;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.inherit = 1;
+        counter = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+
+    long long count;
+    if (counter < 0 || read(counter, &count, sizeof(count)) != sizeof(count)) return -1;
+    return count;
+#else
+    return -1;
+#endif
+}
+
+/// <summary>
+/// Struct to collect the latencies of one operation
+/// </summary>
+typedef struct
+{
+    double* samples; // Seconds per call
+    int numSamples;
+    int capacity;
+    double items;    // Vertices or calls processed in total, for the throughput
+    double misses;   // Cache misses of the samples that were counted
+    int numCounted;
+} Timing;
+
+/// <summary>
+/// Function to add a latency to a timing
+/// </summary>
+/// <param name="t"></param>
+/// <param name="seconds"></param>
+/// <param name="items"></param>
+static void addSample(Timing* t, double seconds, double items)
+{
+    if (t->numSamples == t->capacity)
+    {
+        t->capacity = t->capacity > 0 ? 2 * t->capacity : 64;
+        double* temp = realloc(t->samples, t->capacity * sizeof(double));
+
+        // Check if memory reallocation was successful
+        if (!temp)
+        {
+            perror("Failed to reallocate memory for samples");
+            exit(EXIT_FAILURE);
+        }
+        t->samples = temp;
+    }
+    t->samples[t->numSamples++] = seconds;
+    t->items += items;
+}
+
+/// <summary>
+/// Function to add the cache misses of the last sample of a timing
+/// </summary>
+/// <param name="t"></param>
+/// <param name="before">Value of cacheMisses when the sample started</param>
+static void addMisses(Timing* t, long long before)
+{
+    long long after = cacheMisses();
+    if (before < 0 || after < 0) return;
+
+    t->misses += (double)(after - before);
+    t->numCounted++;
+}
+
+/// <summary>
+/// Function to compare two latencies for qsort
+/// </summary>
+/// <param name="a"></param>
+/// <param name="b"></param>
+/// <returns></returns>
+static int compareDoubles(const void* a, const void* b)
+{
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+/// <summary>
+/// Function to get a percentile of sorted latencies (nearest rank)
+/// </summary>
+/// <param name="sorted"></param>
+/// <param name="n"></param>
+/// <param name="p">Percentile between 0 and 100</param>
+/// <returns></returns>
+static double percentile(const double sorted[], int n, double p)
+{
+    if (n == 0) return 0;
+    double exact = p / 100.0 * n;
+    int rank = (int)exact;
+    if (rank < exact) rank++;
+    if (rank < 1) rank = 1;
+    if (rank > n) rank = n;
+    return sorted[rank - 1];
+}
+#pragma endregion
+
+#pragma region Report
+/// <summary>
+/// Struct to describe where results are written and how
+/// </summary>
+typedef struct
+{
+    bool json;
+    bool firstResult; // No result was written yet, so the JSON list needs no comma
+} Report;
+
+/// <summary>
+/// Function to write the statistics of one operation and reset its timing
+/// </summary>
+/// <param name="r"></param>
+/// <param name="kind"></param>
+/// <param name="size"></param>
+/// <param name="operation"></param>
+/// <param name="unit">What the items of the throughput are</param>
+/// <param name="t"></param>
+static void reportTiming(Report* r, const char* kind, int size, const char* operation, const char* unit, Timing* t)
+{
+    if (t->numSamples == 0) return;
+
+    qsort(t->samples, t->numSamples, sizeof(double), compareDoubles);
+    double total = 0;
+    for (int i = 0; i < t->numSamples; i++)
+    {
+        total += t->samples[i];
+    }
+    double throughput = total > 0 ? t->items / total : 0;
+    double p50 = percentile(t->samples, t->numSamples, 50);
+    double p90 = percentile(t->samples, t->numSamples, 90);
+    double p99 = percentile(t->samples, t->numSamples, 99);
+    double max = t->samples[t->numSamples - 1];
+
+    // Cache misses per item, only when every sample was counted
+    char misses[32];
+    if (t->numCounted == t->numSamples && t->items > 0) snprintf(misses, sizeof(misses), "%.4g", t->misses / t->items);
+    else snprintf(misses, sizeof(misses), r->json ? "null" : "-");
+
+    if (r->json)
+    {
+        printf("%s\n    {\"kind\": \"%s\", \"rows\": %d, \"cols\": %d, \"operation\": \"%s\", \"samples\": %d, "
+            "\"throughput\": %.6g, \"unit\": \"%s/s\", \"p50_us\": %.3f, \"p90_us\": %.3f, \"p99_us\": %.3f, "
+            "\"max_us\": %.3f, \"peak_rss_kib\": %lld, \"cache_misses_per_item\": %s}",
+            r->firstResult ? "" : ",", kind, size, size, operation, t->numSamples, throughput, unit,
+            p50 * 1e6, p90 * 1e6, p99 * 1e6, max * 1e6, peakRssKiB(), misses);
+    }
+    else
+    {
+        char unitPerSecond[32];
+        snprintf(unitPerSecond, sizeof(unitPerSecond), "%s/s", unit);
+        printf("%-9s %6dx%-6d %-18s %8d %14.6g %-12s %12.3f %12.3f %12.3f %12.3f %12lld %12s\n",
+            kind, size, size, operation, t->numSamples, throughput, unitPerSecond,
+            p50 * 1e6, p90 * 1e6, p99 * 1e6, max * 1e6, peakRssKiB(), misses);
+    }
+    r->firstResult = false;
+
+    t->numSamples = 0;
+    t->items = 0;
+    t->misses = 0;
+    t->numCounted = 0;
+}
+
+/// <summary>
+/// Function to write a note about an operation that was not timed
+/// </summary>
+/// <param name="r"></param>
+/// <param name="kind"></param>
+/// <param name="size"></param>
+/// <param name="operation"></param>
+/// <param name="reason"></param>
+static void reportSkipped(Report* r, const char* kind, int size, const char* operation, const char* reason)
+{
+    if (r->json)
+    {
+        printf("%s\n    {\"kind\": \"%s\", \"rows\": %d, \"cols\": %d, \"operation\": \"%s\", \"skipped\": \"%s\"}",
+            r->firstResult ? "" : ",", kind, size, size, operation, reason);
+    }
+    else
+    {
+        printf("%-9s %6dx%-6d %-18s skipped: %s\n", kind, size, size, operation, reason);
+    }
+    r->firstResult = false;
+}
+#pragma endregion
+
+#pragma region Matrix Generator
+/// <summary>
+/// Function to draw the next number of a xorshift generator, so runs are repeatable on every platform
+/// </summary>
+/// <param name="state"></param>
+/// <returns></returns>
+static uint64_t nextRandom(uint64_t* state)
+{
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return *state = x;
+}
+
+/// <summary>
+/// Function to write a matrix file in the format read by loadMatrixFromFile.
+/// "random" has uniform values, "constant" makes every path tie (the worst case for pruning and path counts),
+/// and "gradient" grows towards the bottom-right corner so the best path keeps changing along the way.
+/// </summary>
+/// <param name="filename"></param>
+/// <param name="size">Number of rows and columns</param>
+/// <param name="kind"></param>
+/// <param name="seed"></param>
+/// <returns>true if the file was written</returns>
+static bool generateMatrixFile(const char* filename, int size, const char* kind, uint64_t seed)
+{
+    FILE* file = fopen(filename, "wb");
+    if (!file)
+    {
+        perror("Unable to create matrix file");
+        return false;
+    }
+
+    uint64_t state = seed * 2654435761u + 1;
+    OutputBuffer ob;
+    outputBegin(&ob, file);
+    for (int row = 0; row < size; row++)
+    {
+        for (int col = 0; col < size; col++)
+        {
+            int value;
+            if (strcmp(kind, "constant") == 0) value = 500;
+            else if (strcmp(kind, "gradient") == 0) value = (int)((row + col) * 1000LL / (2 * size)) + (int)(nextRandom(&state) % 10);
+            else value = (int)(nextRandom(&state) % 1000);
+
+            if (col > 0) outputText(&ob, ";");
+            outputInt(&ob, value);
+        }
+        outputText(&ob, "\n");
+    }
+    bool ok = outputEnd(&ob);
+    ok = (fclose(file) == 0) && ok;
+    if (!ok) perror("Failed to write matrix file");
+    return ok;
+}
+
+/// <summary>
+/// Function to load a matrix file into nodes with the cells numbered in random order, like a graph whose vertices
+/// were added in no particular order. The edges are the same as with loadMatrixFromFile and the graph is frozen.
+/// </summary>
+/// <param name="g">Empty graph</param>
+/// <param name="filename"></param>
+/// <param name="state">State of the random generator</param>
+/// <param name="first">Id of the top-left cell</param>
+/// <param name="last">Id of the bottom-right cell</param>
+static void loadShuffledMatrix(Graph* g, const char* filename, uint64_t* state, int* first, int* last)
+{
+    int numRows, numCols;
+    int* values = readMatrixFile(filename, &numRows, &numCols);
+    int numValues = numRows * numCols;
+
+    // Id of each cell, shuffled with Fisher-Yates
+    int* ids = malloc(numValues * sizeof(int));
+    int* cells = malloc(numValues * sizeof(int));
+    int (*edges)[2] = malloc((2 * (size_t)numValues + 1) * sizeof(*edges));
+    if (!ids || !cells || !edges)
+    {
+        perror("Failed to allocate memory for the shuffled matrix");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < numValues; i++) ids[i] = i;
+    for (int i = numValues - 1; i > 0; i--)
+    {
+        int j = (int)(nextRandom(state) % (uint64_t)(i + 1));
+        int id = ids[i];
+        ids[i] = ids[j];
+        ids[j] = id;
+    }
+    for (int i = 0; i < numValues; i++) cells[ids[i]] = i;
+
+    reserveVertices(g, numValues);
+    for (int v = 0; v < numValues; v++)
+    {
+        addVertex(g, values[cells[v]]);
+    }
+
+    // Connect each cell to the right and to the bottom
+    int numEdges = 0;
+    for (int i = 0; i < numValues; i++)
+    {
+        if (i % numCols < numCols - 1)
+        {
+            edges[numEdges][0] = ids[i];
+            edges[numEdges++][1] = ids[i + 1];
+        }
+        if (i / numCols < numRows - 1)
+        {
+            edges[numEdges][0] = ids[i];
+            edges[numEdges++][1] = ids[i + numCols];
+        }
+    }
+    addEdgesBulk(g, (const int (*)[2])edges, numEdges);
+    freezeGraph(g);
+
+    *first = ids[0];
+    *last = ids[numValues - 1];
+    free(values);
+    free(ids);
+    free(cells);
+    free(edges);
+}
+#pragma endregion
+
+#pragma region Benchmarks
+/// <summary>
+/// Struct to hold the settings of a benchmark run
+/// </summary>
+typedef struct
+{
+    int sizes[MAX_SIZES];
+    int numSizes;
+    const char* kinds[8];
+    int numKinds;
+    int repeat;  // Runs of the operations that process the whole graph
+    int samples; // Calls timed for the operations on single vertices or edges
+    uint64_t seed;
+    const char* dir;
+} Settings;
+
+/// <summary>
+/// Function to time dfs and allPaths on one numbering of a matrix graph, with the cache misses per vertex or path
+/// </summary>
+/// <param name="s"></param>
+/// <param name="r"></param>
+/// <param name="kind"></param>
+/// <param name="size"></param>
+/// <param name="g">Frozen graph of the matrix</param>
+/// <param name="first">Id of the top-left cell</param>
+/// <param name="last">Id of the bottom-right cell</param>
+/// <param name="order">Name of the numbering, for the operation names</param>
+/// <param name="t"></param>
+static void benchmarkLayout(const Settings* s, Report* r, const char* kind, int size, Graph* g, int first, int last,
+    const char* order, Timing* t)
+{
+    char operation[32];
+    int maxSum, bestPathLen;
+    int* bestPath = malloc(g->numVertices * sizeof(int));
+    if (!bestPath)
+    {
+        perror("Failed to allocate memory for the best path");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < s->repeat; i++)
+    {
+        invalidateHighestSumCache(g);
+        long long misses = cacheMisses();
+        double start = wallClock();
+        dfs(g, first, &maxSum, bestPath, &bestPathLen);
+        addSample(t, wallClock() - start, (double)g->numVertices);
+        addMisses(t, misses);
+    }
+    free(bestPath);
+    snprintf(operation, sizeof(operation), "dfs %s", order);
+    reportTiming(r, kind, size, operation, "vertices", t);
+
+    snprintf(operation, sizeof(operation), "allPaths %s", order);
+    PathStats stats;
+    bool fewPaths = pathStatistics(g, first, last, &stats, NULL, 0)
+        && stats.count.high == 0 && stats.count.low <= MAX_BENCHMARK_PATHS;
+    FILE* sink = fewPaths ? fopen(NULL_DEVICE, "w") : NULL;
+    if (!sink)
+    {
+        reportSkipped(r, kind, size, operation, "too many paths");
+        return;
+    }
+    for (int i = 0; i < s->repeat; i++)
+    {
+        long long misses = cacheMisses();
+        double start = wallClock();
+        allPathsToFile(g, first, last, sink);
+        addSample(t, wallClock() - start, (double)stats.count.low);
+        addMisses(t, misses);
+    }
+    fclose(sink);
+    reportTiming(r, kind, size, operation, "paths", t);
+}
+
+/// <summary>
+/// Function to time the vertex reordering of a matrix graph numbered in random order, and dfs and allPaths before
+/// and after it. The Hilbert order is measured on the matrix loaded as a grid, the only form it applies to.
+/// </summary>
+/// <param name="s"></param>
+/// <param name="r"></param>
+/// <param name="kind"></param>
+/// <param name="size"></param>
+/// <param name="matrixName"></param>
+/// <param name="state">State of the random generator</param>
+/// <param name="t"></param>
+static void benchmarkReordering(const Settings* s, Report* r, const char* kind, int size, const char* matrixName,
+    uint64_t* state, Timing* t)
+{
+    static const struct { ReorderStrategy strategy; const char* name; } strategies[] = {
+        { REORDER_BFS, "bfs" }, { REORDER_RCM, "rcm" }, { REORDER_HILBERT, "hilbert" }
+    };
+
+    int first, last;
+    Graph* g = createGraph(1);
+    loadShuffledMatrix(g, matrixName, state, &first, &last);
+    benchmarkLayout(s, r, kind, size, g, first, last, "shuffled", t);
+    freeGraph(g);
+
+    for (int k = 0; k < 3; k++)
+    {
+        char operation[32];
+        snprintf(operation, sizeof(operation), "reorder %s", strategies[k].name);
+
+        // Each run starts again from the shuffled numbering; the last one is kept for the searches
+        for (int i = 0; i < s->repeat; i++)
+        {
+            if (i > 0) freeGraph(g);
+            g = createGraph(1);
+            if (strategies[k].strategy == REORDER_HILBERT)
+            {
+                loadMatrixAsGrid(g, matrixName, STENCIL_RIGHT_DOWN);
+                first = 0;
+                last = g->numVertices - 1;
+            }
+            else
+            {
+                loadShuffledMatrix(g, matrixName, state, &first, &last);
+            }
+
+            double start = wallClock();
+            int* newIds = reorderGraph(g, strategies[k].strategy);
+            addSample(t, wallClock() - start, (double)g->numVertices);
+            first = newIds[first];
+            last = newIds[last];
+            free(newIds);
+        }
+        reportTiming(r, kind, size, operation, "vertices", t);
+
+        benchmarkLayout(s, r, kind, size, g, first, last, strategies[k].name, t);
+        freeGraph(g);
+    }
+}
+
+/// <summary>
+/// Function to time every operation on the matrices of one size and kind
+/// </summary>
+/// <param name="s"></param>
+/// <param name="r"></param>
+/// <param name="kind"></param>
+/// <param name="size"></param>
+static void benchmarkMatrix(const Settings* s, Report* r, const char* kind, int size)
+{
+    char matrixName[1024], dotName[1024];
+    snprintf(matrixName, sizeof(matrixName), "%s/bench_%s_%d.txt", s->dir, kind, size);
+    snprintf(dotName, sizeof(dotName), "%s/bench_%s_%d.dot", s->dir, kind, size);
+    if (!generateMatrixFile(matrixName, size, kind, s->seed)) return;
+
+    long long numVertices = (long long)size * size;
+    uint64_t state = s->seed * 0x9E3779B97F4A7C15ULL + (uint64_t)size;
+    Timing t = { NULL, 0, 0, 0, 0, 0 };
+    double start;
+
+    // Loading: as a grid, which keeps only the values, and into nodes
+    for (int i = 0; i < s->repeat; i++)
+    {
+        Graph* g = createGraph(1);
+        start = wallClock();
+        loadMatrixAsGrid(g, matrixName, STENCIL_RIGHT_DOWN);
+        addSample(&t, wallClock() - start, (double)numVertices);
+        freeGraph(g);
+    }
+    reportTiming(r, kind, size, "loadMatrixAsGrid", "vertices", &t);
+
+    // Highest sum of the grid with the wavefront kernel; the path has at most one cell per row and column
+    Graph* grid = createGraph(1);
+    loadMatrixAsGrid(grid, matrixName, STENCIL_RIGHT_DOWN);
+    int gridSum, gridPathLen;
+    int* gridPath = malloc(2 * size * sizeof(int));
+    if (!gridPath)
+    {
+        perror("Failed to allocate memory for the best path");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < s->repeat; i++)
+    {
+        start = wallClock();
+        gridHighestSum(grid, 0, &gridSum, gridPath, &gridPathLen);
+        addSample(&t, wallClock() - start, (double)numVertices);
+    }
+    reportTiming(r, kind, size, "gridHighestSum", "vertices", &t);
+    for (int i = 0; i < s->repeat; i++)
+    {
+        start = wallClock();
+        gridHighestSumParallel(grid, 0, &gridSum, gridPath, &gridPathLen, 0);
+        addSample(&t, wallClock() - start, (double)numVertices);
+    }
+    reportTiming(r, kind, size, "gridHighestSumParallel", "vertices", &t);
+    free(gridPath);
+
+    // Highest sum read straight from the file, without loading the matrix
+    GridCell origin = { 0, 0 };
+    int streamCols;
+    for (int i = 0; i < s->repeat; i++)
+    {
+        start = wallClock();
+        free(streamHighestSum(matrixName, origin, &gridSum, &gridPathLen, &streamCols));
+        addSample(&t, wallClock() - start, (double)numVertices);
+    }
+    reportTiming(r, kind, size, "streamHighestSum", "vertices", &t);
+    freeGraph(grid);
+
+    if (numVertices > MAX_NODE_VERTICES)
+    {
+        reportSkipped(r, kind, size, "loadMatrixFromFile", "too many vertices for the node form");
+        remove(matrixName);
+        return;
+    }
+
+    Graph* g = NULL;
+    for (int i = 0; i < s->repeat; i++)
+    {
+        if (g) freeGraph(g);
+        g = createGraph(1);
+        start = wallClock();
+        loadMatrixFromFile(g, matrixName);
+        addSample(&t, wallClock() - start, (double)numVertices);
+    }
+    reportTiming(r, kind, size, "loadMatrixFromFile", "vertices", &t);
+
+    // Highest sum, computed from scratch each time (the tables kept between queries are dropped first)
+    freezeGraph(g);
+    int maxSum, bestPathLen;
+    int* bestPath = malloc(g->numVertices * sizeof(int));
+    if (!bestPath)
+    {
+        perror("Failed to allocate memory for the best path");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < s->repeat; i++)
+    {
+        invalidateHighestSumCache(g);
+        long long misses = cacheMisses();
+        start = wallClock();
+        dfs(g, 0, &maxSum, bestPath, &bestPathLen);
+        addSample(&t, wallClock() - start, (double)numVertices);
+        addMisses(&t, misses);
+    }
+    reportTiming(r, kind, size, "dfs", "vertices", &t);
+
+    // All paths, printed to the null device, only while the count stays reasonable
+    PathStats stats;
+    bool fewPaths = pathStatistics(g, 0, g->numVertices - 1, &stats, NULL, 0)
+        && stats.count.high == 0 && stats.count.low <= MAX_BENCHMARK_PATHS;
+    FILE* sink = fewPaths ? fopen(NULL_DEVICE, "w") : NULL;
+    if (sink)
+    {
+        for (int i = 0; i < s->repeat; i++)
+        {
+            long long misses = cacheMisses();
+            start = wallClock();
+            allPathsToFile(g, 0, g->numVertices - 1, sink);
+            addSample(&t, wallClock() - start, (double)stats.count.low);
+            addMisses(&t, misses);
+        }
+        fclose(sink);
+        reportTiming(r, kind, size, "allPaths", "paths", &t);
+
+        // The same paths taken one at a time, without formatting them
+        for (int i = 0; i < s->repeat; i++)
+        {
+            PathIterator it;
+            const int* path;
+            int pathLen, pathSum;
+            start = wallClock();
+            pathIterBegin(&it, g, 0, g->numVertices - 1, 0, -1);
+            while (pathIterNext(&it, &path, &pathLen, &pathSum));
+            pathIterEnd(&it);
+            addSample(&t, wallClock() - start, (double)stats.count.low);
+        }
+        reportTiming(r, kind, size, "pathIterNext", "paths", &t);
+    }
+    else
+    {
+        reportSkipped(r, kind, size, "allPaths", "too many paths");
+    }
+
+    // DOT export of the graph with the best path highlighted
+    if (numVertices <= MAX_DOT_VERTICES)
+    {
+        for (int i = 0; i < s->repeat; i++)
+        {
+            start = wallClock();
+            generateDotFile(g, dotName, bestPath, bestPathLen);
+            addSample(&t, wallClock() - start, (double)numVertices);
+        }
+        remove(dotName);
+        reportTiming(r, kind, size, "generateDotFile", "vertices", &t);
+    }
+    else
+    {
+        reportSkipped(r, kind, size, "generateDotFile", "too many vertices for a DOT file");
+    }
+    free(bestPath);
+
+    // Point to point queries from a few sources, answered together (the tables kept between queries are dropped first)
+    int numPairs = s->samples;
+    int (*pairs)[2] = malloc(numPairs * sizeof(*pairs));
+    int* pairSums = malloc(numPairs * sizeof(int));
+    int* pairLens = malloc(numPairs * sizeof(int));
+    if (!pairs || !pairSums || !pairLens)
+    {
+        perror("Failed to allocate memory for the queries");
+        exit(EXIT_FAILURE);
+    }
+    for (int i = 0; i < numPairs; i++)
+    {
+        pairs[i][0] = (int)(nextRandom(&state) % 16 * (g->numVertices / 16));
+        pairs[i][1] = (int)(nextRandom(&state) % g->numVertices);
+    }
+    for (int i = 0; i < s->repeat; i++)
+    {
+        int* pairPaths;
+        invalidatePathTables(g);
+        start = wallClock();
+        bestPathsBetween(g, (const int (*)[2])pairs, numPairs, pairSums, pairLens, &pairPaths);
+        addSample(&t, wallClock() - start, (double)numPairs);
+        free(pairPaths);
+    }
+    reportTiming(r, kind, size, "bestPathsBetween", "queries", &t);
+    free(pairs);
+    free(pairSums);
+    free(pairLens);
+
+    // The same searches on a randomly numbered copy of the graph, before and after renumbering it
+    benchmarkReordering(s, r, kind, size, matrixName, &state, &t);
+
+    // Single edits, each call timed on its own. The first call also turns the frozen graph back into nodes,
+    // which shows up in the maximum latency.
+    int calls = s->samples < g->numVertices ? s->samples : g->numVertices;
+    for (int i = 0; i < calls; i++)
+    {
+        int from = (int)(nextRandom(&state) % g->numVertices);
+        int to = (int)(nextRandom(&state) % g->numVertices);
+        start = wallClock();
+        addEdge(g, from, to);
+        addSample(&t, wallClock() - start, 1);
+    }
+    reportTiming(r, kind, size, "addEdge", "calls", &t);
+
+    for (int i = 0; i < calls; i++)
+    {
+        start = wallClock();
+        addVertexAtStart(g, (int)(nextRandom(&state) % 1000));
+        addSample(&t, wallClock() - start, 1);
+    }
+    reportTiming(r, kind, size, "addVertexAtStart", "calls", &t);
+
+    for (int i = 0; i < calls; i++)
+    {
+        // Pick vertices that were not removed yet
+        int v;
+        do
+        {
+            v = (int)(nextRandom(&state) % g->numVertices);
+        } while (!vertexExists(g, v));
+
+        start = wallClock();
+        removeVertex(g, v);
+        addSample(&t, wallClock() - start, 1);
+    }
+    reportTiming(r, kind, size, "removeVertex", "calls", &t);
+
+    freeGraph(g);
+    free(t.samples);
+    remove(matrixName);
+}
+
+/// <summary>
+/// Function to read a comma separated list of sizes
+/// </summary>
+/// <param name="text"></param>
+/// <param name="s"></param>
+/// <returns>true if the list is valid</returns>
+static bool parseSizes(const char* text, Settings* s)
+{
+    s->numSizes = 0;
+    while (*text && s->numSizes < MAX_SIZES)
+    {
+        char* end;
+        long size = strtol(text, &end, 10);
+        if (end == text || size < 2 || size > 10000) return false;
+        s->sizes[s->numSizes++] = (int)size;
+        text = *end == ',' ? end + 1 : end;
+    }
+    return s->numSizes > 0 && *text == '\0';
+}
+
+/// <summary>
+/// Function to read a comma separated list of matrix kinds
+/// </summary>
+/// <param name="text"></param>
+/// <param name="s"></param>
+/// <returns>true if the list is valid</returns>
+static bool parseKinds(char* text, Settings* s)
+{
+    s->numKinds = 0;
+    for (char* kind = strtok(text, ","); kind && s->numKinds < 8; kind = strtok(NULL, ","))
+    {
+        if (strcmp(kind, "random") != 0 && strcmp(kind, "constant") != 0 && strcmp(kind, "gradient") != 0) return false;
+        s->kinds[s->numKinds++] = kind;
+    }
+    return s->numKinds > 0;
+}
+#pragma endregion
+
+#pragma region Main
+/// <summary>
+/// Main function
+/// </summary>
+/// <returns></returns>
+int main(int argc, char* argv[])
+{
+    Settings s = { { 10, 100, 1000 }, 3, { "random", "constant", "gradient" }, 3, 5, 10000, 1, "." };
+    Report r = { false, true };
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool hasValue = i + 1 < argc;
+        bool ok = true;
+        if (strcmp(argv[i], "--json") == 0) r.json = true;
+        else if (strcmp(argv[i], "--sizes") == 0 && hasValue) ok = parseSizes(argv[++i], &s);
+        else if (strcmp(argv[i], "--kinds") == 0 && hasValue) ok = parseKinds(argv[++i], &s);
+        else if (strcmp(argv[i], "--repeat") == 0 && hasValue) ok = (s.repeat = atoi(argv[++i])) > 0;
+        else if (strcmp(argv[i], "--samples") == 0 && hasValue) ok = (s.samples = atoi(argv[++i])) > 0;
+        else if (strcmp(argv[i], "--seed") == 0 && hasValue) s.seed = strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--dir") == 0 && hasValue) s.dir = argv[++i];
+        else ok = false;
+
+        if (!ok)
+        {
+            fprintf(stderr, "Usage: %s [--sizes 10,100,1000] [--kinds random,constant,gradient] [--repeat 5] "
+                "[--samples 10000] [--seed 1] [--dir .] [--json]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (r.json)
+    {
+        printf("{\"seed\": %llu, \"threads\": %d, \"results\": [", (unsigned long long)s.seed, cpuCount());
+    }
+    else
+    {
+        printf("%-9s %13s %-18s %8s %14s %-12s %12s %12s %12s %12s %12s %12s\n", "kind", "size", "operation", "samples",
+            "throughput", "unit", "p50 (us)", "p90 (us)", "p99 (us)", "max (us)", "peak RSS KiB", "misses/item");
+    }
+
+    for (int k = 0; k < s.numKinds; k++)
+    {
+        for (int i = 0; i < s.numSizes; i++)
+        {
+            benchmarkMatrix(&s, &r, s.kinds[k], s.sizes[i]);
+            fflush(stdout);
+        }
+    }
+
+    if (r.json)
+    {
+        printf("\n]}\n");
+    }
+    return 0;
+}
+#pragma endregion
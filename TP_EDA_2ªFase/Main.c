@@ -1,650 +1,7186 @@
+// madvise, fseeko and the other POSIX and BSD calls are hidden by a strict -std=c11 without this
+#ifndef _WIN32
+#define _DEFAULT_SOURCE
+#endif
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <limits.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+// The grid wavefront kernels use SSE4.1 or AVX2 when the processor has them; other targets only get the scalar kernel
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define GRID_SIMD
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define TARGET_SSE41
+#define TARGET_AVX2
+#else
+#define TARGET_SSE41 __attribute__((target("sse4.1")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+#pragma region File Mapping
+/// <summary>
+/// Struct to represent a memory mapping of a whole file
+/// </summary>
+typedef struct
+{
+    char* data;
+    size_t size;
+#ifdef _WIN32
+    HANDLE file;
+    HANDLE mapping;
+#else
+    int fd;
+#endif
+} MappedFile;
+
+/// <summary>
+/// Function to map a file into memory for reading
+/// </summary>
+/// <param name="filename"></param>
+/// <param name="mf"></param>
+/// <param name="copyOnWrite">If true, the mapped data can be modified in memory without changing the file</param>
+/// <returns>true if the file was mapped, false if it could not be opened or mapped</returns>
+bool mapFile(const char* filename, MappedFile* mf, bool copyOnWrite)
+{
+    mf->data = NULL;
+    mf->size = 0;
+
+#ifdef _WIN32
+    mf->mapping = NULL;
+    mf->file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (mf->file == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(mf->file, &fileSize))
+    {
+        CloseHandle(mf->file);
+        return false;
+    }
+    mf->size = (size_t)fileSize.QuadPart;
+
+    // Empty files cannot be mapped, they are simply seen as no data
+    if (mf->size == 0) return true;
+
+    mf->mapping = CreateFileMappingA(mf->file, NULL, copyOnWrite ? PAGE_WRITECOPY : PAGE_READONLY, 0, 0, NULL);
+    mf->data = mf->mapping ? MapViewOfFile(mf->mapping, copyOnWrite ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0) : NULL;
+    if (!mf->data)
+    {
+        if (mf->mapping) CloseHandle(mf->mapping);
+        CloseHandle(mf->file);
+        return false;
+    }
+#else
+    mf->fd = open(filename, O_RDONLY);
+    if (mf->fd < 0) return false;
+
+    struct stat st;
+    if (fstat(mf->fd, &st) != 0)
+    {
+        close(mf->fd);
+        return false;
+    }
+    mf->size = (size_t)st.st_size;
+
+    // Empty files cannot be mapped, they are simply seen as no data
+    if (mf->size == 0) return true;
+
+    void* data = mmap(NULL, mf->size, copyOnWrite ? PROT_READ | PROT_WRITE : PROT_READ, MAP_PRIVATE, mf->fd, 0);
+    if (data == MAP_FAILED)
+    {
+        close(mf->fd);
+        return false;
+    }
+    mf->data = data;
+#endif
+
+    return true;
+}
+
+/// <summary>
+/// Function to release a file mapped with mapFile
+/// </summary>
+/// <param name="mf"></param>
+void unmapFile(MappedFile* mf)
+{
+#ifdef _WIN32
+    if (mf->data) UnmapViewOfFile(mf->data);
+    if (mf->mapping) CloseHandle(mf->mapping);
+    CloseHandle(mf->file);
+#else
+    if (mf->data) munmap(mf->data, mf->size);
+    close(mf->fd);
+#endif
+    mf->data = NULL;
+    mf->size = 0;
+}
+#pragma endregion
+
+#pragma region Threads
+#ifdef _WIN32
+typedef HANDLE Thread;
+typedef SRWLOCK Mutex;
+typedef CONDITION_VARIABLE Condition;
+typedef volatile long AtomicInt;
+#define THREAD_FUNCTION DWORD WINAPI
+#define THREAD_RETURN 0
+typedef LPTHREAD_START_ROUTINE ThreadStart;
+#else
+typedef pthread_t Thread;
+typedef pthread_mutex_t Mutex;
+typedef pthread_cond_t Condition;
+typedef volatile long AtomicInt;
+#define THREAD_FUNCTION void*
+#define THREAD_RETURN NULL
+typedef void* (*ThreadStart)(void*);
+#endif
+
+/// <summary>
+/// Function to start a thread running fn(arg)
+/// </summary>
+/// <param name="t"></param>
+/// <param name="fn"></param>
+/// <param name="arg"></param>
+/// <returns>true if the thread was started</returns>
+bool startThread(Thread* t, ThreadStart fn, void* arg)
+{
+#ifdef _WIN32
+    *t = CreateThread(NULL, 0, fn, arg, 0, NULL);
+    return *t != NULL;
+#else
+    return pthread_create(t, NULL, fn, arg) == 0;
+#endif
+}
+
+/// <summary>
+/// Function to wait for a thread to finish
+/// </summary>
+/// <param name="t"></param>
+void joinThread(Thread t)
+{
+#ifdef _WIN32
+    WaitForSingleObject(t, INFINITE);
+    CloseHandle(t);
+#else
+    pthread_join(t, NULL);
+#endif
+}
+
+/// <summary>
+/// Function to get the number of processors available to the program
+/// </summary>
+/// <returns></returns>
+int cpuCount(void)
+{
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (int)info.dwNumberOfProcessors;
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int)count : 1;
+#endif
+}
+
+/// <summary>
+/// Function to initialize a mutex
+/// </summary>
+/// <param name="m"></param>
+void initMutex(Mutex* m)
+{
+#ifdef _WIN32
+    InitializeSRWLock(m);
+#else
+    pthread_mutex_init(m, NULL);
+#endif
+}
+
+/// <summary>
+/// Function to release the resources of a mutex
+/// </summary>
+/// <param name="m"></param>
+void destroyMutex(Mutex* m)
+{
+#ifdef _WIN32
+    (void)m; // Slim reader/writer locks need no cleanup
+#else
+    pthread_mutex_destroy(m);
+#endif
+}
+
+/// <summary>
+/// Function to lock a mutex
+/// </summary>
+/// <param name="m"></param>
+void lockMutex(Mutex* m)
+{
+#ifdef _WIN32
+    AcquireSRWLockExclusive(m);
+#else
+    pthread_mutex_lock(m);
+#endif
+}
+
+/// <summary>
+/// Function to unlock a mutex
+/// </summary>
+/// <param name="m"></param>
+void unlockMutex(Mutex* m)
+{
+#ifdef _WIN32
+    ReleaseSRWLockExclusive(m);
+#else
+    pthread_mutex_unlock(m);
+#endif
+}
+
+/// <summary>
+/// Function to initialize a condition variable
+/// </summary>
+/// <param name="c"></param>
+void initCondition(Condition* c)
+{
+#ifdef _WIN32
+    InitializeConditionVariable(c);
+#else
+    pthread_cond_init(c, NULL);
+#endif
+}
+
+/// <summary>
+/// Function to release the resources of a condition variable
+/// </summary>
+/// <param name="c"></param>
+void destroyCondition(Condition* c)
+{
+#ifdef _WIN32
+    (void)c; // Condition variables need no cleanup
+#else
+    pthread_cond_destroy(c);
+#endif
+}
+
+/// <summary>
+/// Function to unlock a mutex and sleep until the condition variable is woken, locking the mutex again before returning.
+/// It can also return without being woken, so the caller must check its condition again.
+/// </summary>
+/// <param name="c"></param>
+/// <param name="m">Mutex held by the caller</param>
+void waitCondition(Condition* c, Mutex* m)
+{
+#ifdef _WIN32
+    SleepConditionVariableSRW(c, m, INFINITE, 0);
+#else
+    pthread_cond_wait(c, m);
+#endif
+}
+
+/// <summary>
+/// Function to wake one thread waiting on a condition variable
+/// </summary>
+/// <param name="c"></param>
+void wakeOne(Condition* c)
+{
+#ifdef _WIN32
+    WakeConditionVariable(c);
+#else
+    pthread_cond_signal(c);
+#endif
+}
+
+/// <summary>
+/// Function to wake every thread waiting on a condition variable
+/// </summary>
+/// <param name="c"></param>
+void wakeAll(Condition* c)
+{
+#ifdef _WIN32
+    WakeAllConditionVariable(c);
+#else
+    pthread_cond_broadcast(c);
+#endif
+}
+
+/// <summary>
+/// Function to read an atomic integer
+/// </summary>
+/// <param name="a"></param>
+/// <returns></returns>
+static inline long atomicLoad(AtomicInt* a)
+{
+#ifdef _WIN32
+    return InterlockedCompareExchange(a, 0, 0);
+#else
+    return __atomic_load_n(a, __ATOMIC_ACQUIRE);
+#endif
+}
+
+/// <summary>
+/// Function to write an atomic integer
+/// </summary>
+/// <param name="a"></param>
+/// <param name="value"></param>
+static inline void atomicStore(AtomicInt* a, long value)
+{
+#ifdef _WIN32
+    InterlockedExchange(a, value);
+#else
+    __atomic_store_n(a, value, __ATOMIC_RELEASE);
+#endif
+}
+
+/// <summary>
+/// Function to add to an atomic integer
+/// </summary>
+/// <param name="a"></param>
+/// <param name="value"></param>
+/// <returns>The value before the addition</returns>
+static inline long atomicAdd(AtomicInt* a, long value)
+{
+#ifdef _WIN32
+    return InterlockedExchangeAdd(a, value);
+#else
+    return __atomic_fetch_add(a, value, __ATOMIC_ACQ_REL);
+#endif
+}
+#pragma endregion
+
+#pragma region Search Statistics
+// Only the first improvements of the best sum are logged with their time
+#define MAX_LOGGED_IMPROVEMENTS 16
+
+/// <summary>
+/// Enum to represent the phases of a query that are timed
+/// </summary>
+typedef enum
+{
+    PHASE_LOAD,   // Reading the matrix or the snapshot
+    PHASE_BUILD,  // Freezing the graph and building the highest sum tables
+    PHASE_SEARCH,
+    PHASE_EXPORT, // Writing the DOT files
+    NUM_PHASES
+} SearchPhase;
+
+/// <summary>
+/// Struct to represent the counters and timings of the last query
+/// </summary>
+typedef struct
+{
+    const char* solver;      // Solver that answered the query
+    long long expanded;      // Vertices added to a path, or recomputed by the acyclic solvers
+    long long backtracks;    // Edges not followed because the vertex was already on the path or the subtree was cut
+    int maxDepth;            // Longest path held by the search
+    long long pathsCompleted;
+    int improvements;        // Times the best sum went up
+    int numLogged;
+    double improvementTime[MAX_LOGGED_IMPROVEMENTS]; // Seconds since the search started
+    int improvementSum[MAX_LOGGED_IMPROVEMENTS];
+    double searchStart;
+    double phaseTime[NUM_PHASES]; // Seconds
+} SearchStats;
+
+// Statistics being collected, or NULL while collection is off so that the solvers only pay for a test
+static SearchStats* searchStats = NULL;
+
+/// <summary>
+/// Function to read a monotonic clock
+/// </summary>
+/// <returns>Time in seconds from an arbitrary origin</returns>
+double wallClock(void)
+{
+#ifdef _WIN32
+    LARGE_INTEGER counter, frequency;
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+    return (double)counter.QuadPart / (double)frequency.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+#endif
+}
+
+/// <summary>
+/// Function to clear the statistics before a query. The load time is kept, since the graph is only loaded once.
+/// </summary>
+/// <param name="s"></param>
+void resetSearchStats(SearchStats* s)
+{
+    double load = s->phaseTime[PHASE_LOAD];
+    memset(s, 0, sizeof(SearchStats));
+    s->solver = "none";
+    s->phaseTime[PHASE_LOAD] = load;
+}
+
+/// <summary>
+/// Function to start the search phase of a query
+/// </summary>
+/// <param name="s">Statistics, or NULL when off</param>
+/// <param name="solver"></param>
+static inline void statsSearchStarted(SearchStats* s, const char* solver)
+{
+    if (!s) return;
+    s->solver = solver;
+    s->searchStart = wallClock();
+}
+
+/// <summary>
+/// Function to count a vertex added to a path at the given depth
+/// </summary>
+/// <param name="s">Statistics, or NULL when off</param>
+/// <param name="depth">Length of the path with the vertex</param>
+static inline void statsExpand(SearchStats* s, int depth)
+{
+    if (!s) return;
+    s->expanded++;
+    if (depth > s->maxDepth) s->maxDepth = depth;
+}
+
+/// <summary>
+/// Function to count edges the search did not follow
+/// </summary>
+/// <param name="s">Statistics, or NULL when off</param>
+/// <param name="count"></param>
+static inline void statsBacktrack(SearchStats* s, long long count)
+{
+    if (s) s->backtracks += count;
+}
+
+/// <summary>
+/// Function to count a path that was followed to its end
+/// </summary>
+/// <param name="s">Statistics, or NULL when off</param>
+static inline void statsPathCompleted(SearchStats* s)
+{
+    if (s) s->pathsCompleted++;
+}
+
+/// <summary>
+/// Function to record a new best sum, with the time it was found
+/// </summary>
+/// <param name="s">Statistics, or NULL when off</param>
+/// <param name="sum"></param>
+static inline void statsImprovement(SearchStats* s, int sum)
+{
+    if (!s) return;
+    if (s->numLogged < MAX_LOGGED_IMPROVEMENTS)
+    {
+        s->improvementTime[s->numLogged] = wallClock() - s->searchStart;
+        s->improvementSum[s->numLogged++] = sum;
+    }
+    s->improvements++;
+}
+
+/// <summary>
+/// Function to start timing a phase
+/// </summary>
+/// <returns>The start time, or 0 when the statistics are off</returns>
+static inline double statsPhaseBegin(void)
+{
+    return searchStats ? wallClock() : 0;
+}
+
+/// <summary>
+/// Function to add the time since statsPhaseBegin to a phase
+/// </summary>
+/// <param name="phase"></param>
+/// <param name="start"></param>
+static inline void statsPhaseEnd(SearchPhase phase, double start)
+{
+    if (searchStats) searchStats->phaseTime[phase] += wallClock() - start;
+}
+
+/// <summary>
+/// Function to add the counters of one search to another, as done with the workers of a parallel search
+/// </summary>
+/// <param name="s"></param>
+/// <param name="other"></param>
+static void mergeSearchStats(SearchStats* s, const SearchStats* other)
+{
+    s->expanded += other->expanded;
+    s->backtracks += other->backtracks;
+    s->pathsCompleted += other->pathsCompleted;
+    if (other->maxDepth > s->maxDepth) s->maxDepth = other->maxDepth;
+}
+
+/// <summary>
+/// Function to print the statistics of the last query
+/// </summary>
+/// <param name="s"></param>
+/// <param name="out"></param>
+void printSearchStats(const SearchStats* s, FILE* out)
+{
+    static const char* phaseNames[NUM_PHASES] = { "Load", "Build", "Search", "Export" };
+
+    fprintf(out, "Solver: %s\n", s->solver);
+    fprintf(out, "Vertices expanded: %lld\n", s->expanded);
+    fprintf(out, "Backtracks: %lld\n", s->backtracks);
+    fprintf(out, "Maximum depth: %d\n", s->maxDepth);
+    fprintf(out, "Paths completed: %lld\n", s->pathsCompleted);
+    fprintf(out, "Improvements: %d\n", s->improvements);
+    for (int i = 0; i < s->numLogged; i++)
+    {
+        fprintf(out, "  %.6f s: %d\n", s->improvementTime[i], s->improvementSum[i]);
+    }
+    for (int p = 0; p < NUM_PHASES; p++)
+    {
+        fprintf(out, "%s time: %.6f s\n", phaseNames[p], s->phaseTime[p]);
+    }
+}
+#pragma endregion
 
 #pragma region Graph
 /// <summary>
-/// Struct to represent a node in a graph
+/// Struct to represent a node in a graph
+/// </summary>
+typedef struct node
+{
+    int id;
+    int value;
+    int numAdj;
+    int adjCapacity; // Room in adjacents, grown by doubling
+    struct node** adjacents;
+    int numIncoming;
+    int incomingCapacity;
+    struct node** incoming; // Vertices with an edge to this one, once per edge
+} Node;
+
+/// <summary>
+/// How the vertices and edges of a graph are currently stored
+/// </summary>
+typedef enum
+{
+    STORAGE_NODES,  // Individual nodes with adjacency lists, the only form that can be modified
+    STORAGE_FROZEN, // Compressed sparse row arrays, see freezeGraph
+    STORAGE_GRID    // Matrix values only, the neighbours are derived from the row and column, see loadMatrixAsGrid
+} GraphStorage;
+
+/// <summary>
+/// Neighbourhood used by a grid graph
+/// </summary>
+typedef enum
+{
+    STENCIL_RIGHT_DOWN,         // Right and bottom neighbours, the same edges loadMatrixFromFile creates
+    STENCIL_RIGHT_DOWN_DIAGONAL // Right, bottom and bottom-right diagonal neighbours
+} GridStencil;
+
+/// <summary>
+/// Struct to represent the slot table of a graph. A vertex keeps its id (its slot) until it is removed, the slots of
+/// removed vertices are reused by later insertions, and the start to end order of the vertices is kept separately.
+/// </summary>
+typedef struct slotTable
+{
+    int capacity;
+    unsigned* generation; // Odd while the slot is free, incremented each time the slot is freed or reused
+    int* prev;            // Previous vertex in the logical order, or -1
+    int* next;            // Next vertex in the logical order (for a free slot, the next free slot), or -1
+    int first;            // First and last vertices in the logical order, or -1
+    int last;
+    int freeList;         // Most recently freed slot, or -1
+    int numFree;
+} SlotTable;
+
+/// <summary>
+/// Struct to refer to a vertex across edits; it stops being valid once the vertex is removed, even if the slot is reused
+/// </summary>
+typedef struct
+{
+    int id;
+    unsigned generation;
+} VertexHandle;
+
+/// <summary>
+/// Struct to represent the memory the nodes and their adjacency and incoming lists are carved from.
+/// Everything is released at once when the graph is frozen or freed.
+/// </summary>
+typedef struct
+{
+    struct arenaBlock* blocks;  // Most recent block first, allocations are taken from its end
+    struct node** freeLists[32]; // freeLists[k]: released lists with room for 1 << k entries, linked through their first entry
+} NodeArena;
+
+/// <summary>
+/// Struct to represent a graph
+/// </summary>
+typedef struct
+{
+    Node** vertices;
+    int numVertices; // Number of slots: vertex ids are below this, removed vertices included
+    int size;
+    SlotTable* slots; // NULL while no vertex was removed or added at the start, so the ids are also the order
+    NodeArena arena;  // Node form: memory of the nodes and their lists
+
+    GraphStorage storage;
+    int* offsets; // Frozen form: neighbours of v are targets[offsets[v]] .. targets[offsets[v + 1] - 1]
+    int* targets;
+    int* values;  // Frozen and grid forms: value of each vertex
+    int* inOffsets; // Frozen form, built on demand: predecessors of v are inSources[inOffsets[v]] .. inSources[inOffsets[v + 1] - 1]
+    int* inSources;
+
+    // Grid form: vertex v is the cell at row v / numCols and column v % numCols
+    int numRows;
+    int numCols;
+    GridStencil stencil;
+
+    // Snapshot file the frozen or grid arrays point into, see loadGraphBinary
+    MappedFile* snapshot;
+
+    // Tables kept between highest sum queries, see cachedHighestSum and bestPathBetween
+    struct highestSumCache* cache;
+    struct pathTableCache* pathTables;
+    int wavefrontStart; // Start vertex of the last query solved by gridHighestSum, or -1
+} Graph;
+
+/// <summary>
+/// Row and column offsets of the neighbours of a cell for each stencil, in the order they are reported
+/// </summary>
+static const int stencilSize[] = { 2, 3 };
+static const int stencilOffsets[][3][2] = {
+    { { 0, 1 }, { 1, 0 } },
+    { { 0, 1 }, { 1, 0 }, { 1, 1 } }
+};
+
+/// <summary>
+/// Function to check if the k-th stencil neighbour of a grid cell is inside the grid
+/// </summary>
+/// <param name="g"></param>
+/// <param name="v"></param>
+/// <param name="k"></param>
+/// <param name="direction">1 for the successor given by the stencil, -1 for the matching predecessor</param>
+/// <returns></returns>
+static inline bool gridHasNeighbour(const Graph* g, int v, int k, int direction)
+{
+    int row = v / g->numCols + direction * stencilOffsets[g->stencil][k][0];
+    int col = v % g->numCols + direction * stencilOffsets[g->stencil][k][1];
+    return row >= 0 && row < g->numRows && col >= 0 && col < g->numCols;
+}
+
+/// <summary>
+/// Function to get the value of a vertex, whatever the storage of the graph
+/// </summary>
+/// <param name="g"></param>
+/// <param name="v"></param>
+/// <returns></returns>
+static inline int vertexValue(const Graph* g, int v)
+{
+    return g->storage == STORAGE_NODES ? g->vertices[v]->value : g->values[v];
+}
+
+/// <summary>
+/// Function to get the number of adjacent vertices of a vertex
+/// </summary>
+/// <param name="g"></param>
+/// <param name="v"></param>
+/// <returns></returns>
+static inline int vertexDegree(const Graph* g, int v)
+{
+    switch (g->storage)
+    {
+    case STORAGE_FROZEN:
+        return g->offsets[v + 1] - g->offsets[v];
+
+    case STORAGE_GRID:
+    {
+        int numAdj = 0;
+        for (int k = 0; k < stencilSize[g->stencil]; k++)
+        {
+            numAdj += gridHasNeighbour(g, v, k, 1);
+        }
+        return numAdj;
+    }
+
+    default:
+        return g->vertices[v]->numAdj;
+    }
+}
+
+/// <summary>
+/// Function to get the id of the i-th adjacent vertex of a vertex
+/// </summary>
+/// <param name="g"></param>
+/// <param name="v"></param>
+/// <param name="i"></param>
+/// <returns></returns>
+static inline int vertexAdjacent(const Graph* g, int v, int i)
+{
+    switch (g->storage)
+    {
+    case STORAGE_FROZEN:
+        return g->targets[g->offsets[v] + i];
+
+    case STORAGE_GRID:
+        // Skip the stencil neighbours that fall outside the grid
+        for (int k = 0; k < stencilSize[g->stencil]; k++)
+        {
+            if (gridHasNeighbour(g, v, k, 1) && i-- == 0)
+            {
+                return v + stencilOffsets[g->stencil][k][0] * g->numCols + stencilOffsets[g->stencil][k][1];
+            }
+        }
+        return -1;
+
+    default:
+        return g->vertices[v]->adjacents[i]->id;
+    }
+}
+
+/// <summary>
+/// Function to get the number of vertices with an edge to a vertex (frozen graphs need buildReverseIndex first)
+/// </summary>
+/// <param name="g"></param>
+/// <param name="v"></param>
+/// <returns></returns>
+static inline int vertexInDegree(const Graph* g, int v)
+{
+    switch (g->storage)
+    {
+    case STORAGE_FROZEN:
+        return g->inOffsets[v + 1] - g->inOffsets[v];
+
+    case STORAGE_GRID:
+    {
+        int numIncoming = 0;
+        for (int k = 0; k < stencilSize[g->stencil]; k++)
+        {
+            numIncoming += gridHasNeighbour(g, v, k, -1);
+        }
+        return numIncoming;
+    }
+
+    default:
+        return g->vertices[v]->numIncoming;
+    }
+}
+
+/// <summary>
+/// Function to get the id of the i-th vertex with an edge to a vertex (frozen graphs need buildReverseIndex first)
+/// </summary>
+/// <param name="g"></param>
+/// <param name="v"></param>
+/// <param name="i"></param>
+/// <returns></returns>
+static inline int vertexPredecessor(const Graph* g, int v, int i)
+{
+    switch (g->storage)
+    {
+    case STORAGE_FROZEN:
+        return g->inSources[g->inOffsets[v] + i];
+
+    case STORAGE_GRID:
+        for (int k = 0; k < stencilSize[g->stencil]; k++)
+        {
+            if (gridHasNeighbour(g, v, k, -1) && i-- == 0)
+            {
+                return v - stencilOffsets[g->stencil][k][0] * g->numCols - stencilOffsets[g->stencil][k][1];
+            }
+        }
+        return -1;
+
+    default:
+        return g->vertices[v]->incoming[i]->id;
+    }
+}
+
+/// <summary>
+/// Function to check if a vertex id refers to a vertex of the graph (and not to the slot of a removed one)
+/// </summary>
+/// <param name="g"></param>
+/// <param name="v"></param>
+/// <returns></returns>
+static inline bool vertexExists(const Graph* g, int v)
+{
+    return v >= 0 && v < g->numVertices && (!g->slots || !(g->slots->generation[v] & 1));
+}
+
+/// <summary>
+/// Function to get the number of vertices in the graph
+/// </summary>
+/// <param name="g"></param>
+/// <returns></returns>
+static inline int vertexCount(const Graph* g)
+{
+    return g->numVertices - (g->slots ? g->slots->numFree : 0);
+}
+
+/// <summary>
+/// Function to get the first vertex of the graph in start to end order
+/// </summary>
+/// <param name="g"></param>
+/// <returns>The vertex id, or -1 if the graph is empty</returns>
+static inline int firstVertex(const Graph* g)
+{
+    if (g->slots) return g->slots->first;
+    return g->numVertices > 0 ? 0 : -1;
+}
+
+/// <summary>
+/// Function to get the last vertex of the graph in start to end order
+/// </summary>
+/// <param name="g"></param>
+/// <returns>The vertex id, or -1 if the graph is empty</returns>
+static inline int lastVertex(const Graph* g)
+{
+    if (g->slots) return g->slots->last;
+    return g->numVertices - 1;
+}
+
+/// <summary>
+/// Function to get the vertex after another one in start to end order
+/// </summary>
+/// <param name="g"></param>
+/// <param name="v"></param>
+/// <returns>The vertex id, or -1 after the last vertex</returns>
+static inline int nextVertex(const Graph* g, int v)
+{
+    if (g->slots) return g->slots->next[v];
+    return v + 1 < g->numVertices ? v + 1 : -1;
+}
+
+/// <summary>
+/// Function to get a handle to a vertex that can be checked later with handleIsValid
+/// </summary>
+/// <param name="g"></param>
+/// <param name="v"></param>
+/// <returns></returns>
+static inline VertexHandle vertexHandle(const Graph* g, int v)
+{
+    VertexHandle h = { v, g->slots ? g->slots->generation[v] : 0 };
+    return h;
+}
+
+/// <summary>
+/// Function to check if a handle still refers to the vertex it was taken from
+/// </summary>
+/// <param name="g"></param>
+/// <param name="h"></param>
+/// <returns></returns>
+static inline bool handleIsValid(const Graph* g, VertexHandle h)
+{
+    return vertexExists(g, h.id) && (g->slots ? g->slots->generation[h.id] : 0) == h.generation;
+}
+#pragma endregion
+
+#pragma region Iterative Search
+/// <summary>
+/// Function to create a set of visited vertices, one bit per vertex slot, with no vertex visited
+/// </summary>
+/// <param name="numVertices"></param>
+/// <returns></returns>
+uint64_t* createVisitedSet(int numVertices)
+{
+    uint64_t* visited = calloc(numVertices > 0 ? (numVertices + 63) / 64 : 1, sizeof(uint64_t));
+
+    // Check if memory allocation was successful
+    if (!visited)
+    {
+        perror("Failed to allocate memory for visited set");
+        exit(EXIT_FAILURE);
+    }
+    return visited;
+}
+
+/// <summary>
+/// Function to check if a vertex is in a visited set
+/// </summary>
+/// <param name="visited"></param>
+/// <param name="v"></param>
+/// <returns></returns>
+static inline bool isVisited(const uint64_t visited[], int v)
+{
+    return (visited[v >> 6] >> (v & 63)) & 1;
+}
+
+/// <summary>
+/// Function to add a vertex to a visited set
+/// </summary>
+/// <param name="visited"></param>
+/// <param name="v"></param>
+static inline void markVisited(uint64_t visited[], int v)
+{
+    visited[v >> 6] |= (uint64_t)1 << (v & 63);
+}
+
+/// <summary>
+/// Function to remove a vertex from a visited set
+/// </summary>
+/// <param name="visited"></param>
+/// <param name="v"></param>
+static inline void clearVisited(uint64_t visited[], int v)
+{
+    visited[v >> 6] &= ~((uint64_t)1 << (v & 63));
+}
+
+/// <summary>
+/// Struct to represent a vertex on the path of an iterative search, with the position of the next adjacent vertex to try
+/// </summary>
+typedef struct
+{
+    int vertex;
+    int next;
+    int numAdj;
+    int sum;       // Sum of the path up to and including the vertex
+    bool extended; // The path went on past the vertex at least once
+} SearchFrame;
+
+/// <summary>
+/// Function to allocate the frames of an iterative search; a path can hold every vertex once
+/// </summary>
+/// <param name="g"></param>
+/// <returns></returns>
+static SearchFrame* createSearchFrames(Graph* g)
+{
+    SearchFrame* frames = malloc((g->numVertices > 0 ? g->numVertices : 1) * sizeof(SearchFrame));
+
+    // Check if memory allocation was successful
+    if (!frames)
+    {
+        perror("Failed to allocate memory for search frames");
+        exit(EXIT_FAILURE);
+    }
+    return frames;
+}
+#pragma endregion
+
+#pragma region Node Arena
+// Size of the blocks the arena takes from malloc; larger requests get a block of their own
+#define ARENA_BLOCK_SIZE (64 * 1024)
+
+/// <summary>
+/// Struct to represent a block of arena memory, followed by its data
+/// </summary>
+typedef struct arenaBlock
+{
+    struct arenaBlock* next;
+    size_t size;
+    size_t used;
+} ArenaBlock;
+
+/// <summary>
+/// Function to take memory from an arena by bumping the position in its current block
+/// </summary>
+/// <param name="arena"></param>
+/// <param name="bytes"></param>
+/// <returns></returns>
+static void* arenaAlloc(NodeArena* arena, size_t bytes)
+{
+    // Keep every allocation aligned for pointers
+    bytes = (bytes + sizeof(void*) - 1) & ~(sizeof(void*) - 1);
+
+    ArenaBlock* block = arena->blocks;
+    if (!block || block->size - block->used < bytes)
+    {
+        size_t size = bytes > ARENA_BLOCK_SIZE ? bytes : ARENA_BLOCK_SIZE;
+        ArenaBlock* newBlock = malloc(sizeof(ArenaBlock) + size);
+
+        // Check if memory allocation was successful
+        if (!newBlock)
+        {
+            perror("Failed to allocate memory for nodes");
+            exit(EXIT_FAILURE);
+        }
+        newBlock->size = size;
+        newBlock->used = 0;
+
+        // A block made for one large request goes behind the current one, which may still have room
+        if (block && size > ARENA_BLOCK_SIZE)
+        {
+            newBlock->next = block->next;
+            block->next = newBlock;
+        }
+        else
+        {
+            newBlock->next = block;
+            arena->blocks = newBlock;
+        }
+        block = newBlock;
+    }
+
+    void* memory = (unsigned char*)(block + 1) + block->used;
+    block->used += bytes;
+    return memory;
+}
+
+/// <summary>
+/// Function to release all the memory of an arena
+/// </summary>
+/// <param name="arena"></param>
+static void arenaRelease(NodeArena* arena)
+{
+    while (arena->blocks)
+    {
+        ArenaBlock* next = arena->blocks->next;
+        free(arena->blocks);
+        arena->blocks = next;
+    }
+    memset(arena->freeLists, 0, sizeof(arena->freeLists));
+}
+
+/// <summary>
+/// Function to get the free list class of a list capacity
+/// </summary>
+/// <param name="capacity"></param>
+/// <returns>k if the capacity is 1 << k, or -1 if it is not a power of two</returns>
+static int listClass(int capacity)
+{
+    if (capacity <= 0 || (capacity & (capacity - 1)) != 0) return -1;
+
+    int k = 0;
+    while ((1 << k) < capacity) k++;
+    return k;
+}
+
+/// <summary>
+/// Function to hand an adjacency or incoming list that is no longer used back to the arena
+/// </summary>
+/// <param name="arena"></param>
+/// <param name="list"></param>
+/// <param name="capacity"></param>
+static void arenaReleaseList(NodeArena* arena, struct node** list, int capacity)
+{
+    // Only the power of two sizes that lists grow through are worth keeping
+    int k = listClass(capacity);
+    if (!list || k < 0) return;
+
+    *(struct node***)list = arena->freeLists[k];
+    arena->freeLists[k] = list;
+}
+
+/// <summary>
+/// Function to make room for at least a given number of entries in an adjacency or incoming list
+/// </summary>
+/// <param name="arena"></param>
+/// <param name="list"></param>
+/// <param name="capacity"></param>
+/// <param name="needed"></param>
+/// <param name="exact">true to allocate exactly the needed room, for lists whose final size is known</param>
+static void reserveNodeList(NodeArena* arena, struct node*** list, int* capacity, int needed, bool exact)
+{
+    if (needed <= *capacity) return;
+
+    // Grow through powers of two so that adding edges one by one stays amortized constant time
+    int newCapacity = needed;
+    if (!exact)
+    {
+        newCapacity = 4;
+        while (newCapacity < needed) newCapacity *= 2;
+    }
+
+    // Reuse a released list of the same size if there is one
+    struct node** newList;
+    int k = listClass(newCapacity);
+    if (k >= 0 && arena->freeLists[k])
+    {
+        newList = arena->freeLists[k];
+        arena->freeLists[k] = *(struct node***)newList;
+    }
+    else
+    {
+        newList = arenaAlloc(arena, newCapacity * sizeof(struct node*));
+    }
+
+    if (*capacity > 0)
+    {
+        memcpy(newList, *list, *capacity * sizeof(struct node*));
+        arenaReleaseList(arena, *list, *capacity);
+    }
+    *list = newList;
+    *capacity = newCapacity;
+}
+#pragma endregion
+
+#pragma region Frozen Graph
+/// <summary>
+/// Function to release the arrays of a frozen or grid graph, whether they were allocated or mapped from a snapshot
+/// </summary>
+/// <param name="g"></param>
+void releaseArrays(Graph* g)
+{
+    if (g->snapshot)
+    {
+        unmapFile(g->snapshot);
+        free(g->snapshot);
+        g->snapshot = NULL;
+    }
+    else
+    {
+        free(g->offsets);
+        free(g->targets);
+        free(g->values);
+    }
+
+    // The reverse index is always built in memory
+    free(g->inOffsets);
+    free(g->inSources);
+
+    g->offsets = NULL;
+    g->targets = NULL;
+    g->values = NULL;
+    g->inOffsets = NULL;
+    g->inSources = NULL;
+}
+
+/// <summary>
+/// Function to build the predecessor lists of a frozen graph, which are only created when a solver needs them
+/// </summary>
+/// <param name="g"></param>
+void buildReverseIndex(Graph* g)
+{
+    if (g->storage != STORAGE_FROZEN || g->inOffsets) return;
+
+    int numEdges = g->offsets[g->numVertices];
+    g->inOffsets = calloc(g->numVertices + 1, sizeof(int));
+    g->inSources = malloc((numEdges > 0 ? numEdges : 1) * sizeof(int));
+    int* fill = malloc((g->numVertices > 0 ? g->numVertices : 1) * sizeof(int));
+
+    // Check if memory allocation was successful
+    if (!g->inOffsets || !g->inSources || !fill)
+    {
+        perror("Failed to allocate memory for reverse index");
+        exit(EXIT_FAILURE);
+    }
+
+    // Count the incoming edges of each vertex, then place the sources in order
+    for (int e = 0; e < numEdges; e++)
+    {
+        g->inOffsets[g->targets[e] + 1]++;
+    }
+    for (int v = 0; v < g->numVertices; v++)
+    {
+        g->inOffsets[v + 1] += g->inOffsets[v];
+        fill[v] = g->inOffsets[v];
+    }
+    for (int v = 0; v < g->numVertices; v++)
+    {
+        for (int e = g->offsets[v]; e < g->offsets[v + 1]; e++)
+        {
+            g->inSources[fill[g->targets[e]]++] = v;
+        }
+    }
+    free(fill);
+}
+
+/// <summary>
+/// Function to freeze a graph into contiguous offsets/targets/values arrays, releasing the individual nodes.
+/// Queries run directly on the frozen form; any mutation thaws the graph first.
+/// </summary>
+/// <param name="g"></param>
+void freezeGraph(Graph* g)
+{
+    // Grid graphs are already read-optimized
+    if (g->storage != STORAGE_NODES) return;
+    double start = statsPhaseBegin();
+
+    // Count the edges to size the targets array
+    int numEdges = 0;
+    for (int i = 0; i < g->numVertices; i++)
+    {
+        numEdges += g->vertices[i]->numAdj;
+    }
+
+    g->offsets = malloc((g->numVertices + 1) * sizeof(int));
+    g->targets = malloc((numEdges > 0 ? numEdges : 1) * sizeof(int));
+    g->values = malloc((g->numVertices > 0 ? g->numVertices : 1) * sizeof(int));
+
+    // Check if memory allocation was successful
+    if (!g->offsets || !g->targets || !g->values)
+    {
+        perror("Failed to allocate memory for frozen graph");
+        exit(EXIT_FAILURE);
+    }
+
+    // Copy the values and adjacency lists, then release the nodes
+    int edge = 0;
+    for (int i = 0; i < g->numVertices; i++)
+    {
+        Node* vertex = g->vertices[i];
+        g->offsets[i] = edge;
+        g->values[i] = vertex->value;
+        for (int j = 0; j < vertex->numAdj; j++)
+        {
+            g->targets[edge++] = vertex->adjacents[j]->id;
+        }
+    }
+    g->offsets[g->numVertices] = edge;
+
+    // The nodes and their lists all live in the arena
+    arenaRelease(&g->arena);
+
+    g->storage = STORAGE_FROZEN;
+    statsPhaseEnd(PHASE_BUILD, start);
+}
+
+/// <summary>
+/// Function to turn a frozen or grid graph back into individual nodes so it can be modified
+/// </summary>
+/// <param name="g"></param>
+void thawGraph(Graph* g)
+{
+    if (g->storage == STORAGE_NODES) return;
+
+    // A grid graph may hold more vertices than the node array was created for
+    if (g->size < g->numVertices)
+    {
+        Node** temp = realloc(g->vertices, g->numVertices * sizeof(Node*));
+
+        // Check if memory reallocation was successful
+        if (!temp)
+        {
+            perror("Failed to reallocate memory for vertices");
+            exit(EXIT_FAILURE);
+        }
+        g->vertices = temp;
+        g->size = g->numVertices;
+    }
+
+    // Recreate the nodes first, the adjacency lists point to them. They are allocated together,
+    // so walking the vertices in order walks contiguous memory.
+    Node** nodes = g->vertices;
+    Node* block = arenaAlloc(&g->arena, g->numVertices * sizeof(Node));
+    int numEdges = 0;
+    for (int i = 0; i < g->numVertices; i++)
+    {
+        Node* newNode = &block[i];
+        newNode->id = i;
+        newNode->value = vertexValue(g, i);
+        newNode->numAdj = vertexDegree(g, i);
+        newNode->adjCapacity = newNode->numAdj;
+        newNode->adjacents = NULL;
+        newNode->numIncoming = 0;
+        newNode->incomingCapacity = 0;
+        newNode->incoming = NULL;
+        nodes[i] = newNode;
+        numEdges += newNode->numAdj;
+    }
+
+    // The adjacency lists, and then the incoming lists, are also laid out one after the other
+    Node** adjacents = arenaAlloc(&g->arena, numEdges * sizeof(Node*));
+    Node** incoming = arenaAlloc(&g->arena, numEdges * sizeof(Node*));
+    for (int i = 0; i < g->numVertices; i++)
+    {
+        Node* vertex = nodes[i];
+        if (vertex->numAdj == 0) continue;
+
+        vertex->adjacents = adjacents;
+        adjacents += vertex->numAdj;
+        for (int j = 0; j < vertex->numAdj; j++)
+        {
+            vertex->adjacents[j] = nodes[vertexAdjacent(g, i, j)];
+            vertex->adjacents[j]->numIncoming++;
+        }
+    }
+
+    // Size the incoming lists from the counts above, then fill them
+    for (int i = 0; i < g->numVertices; i++)
+    {
+        Node* vertex = nodes[i];
+        if (vertex->numIncoming == 0) continue;
+
+        vertex->incoming = incoming;
+        incoming += vertex->numIncoming;
+        vertex->incomingCapacity = vertex->numIncoming;
+        vertex->numIncoming = 0;
+    }
+    for (int i = 0; i < g->numVertices; i++)
+    {
+        Node* vertex = nodes[i];
+        for (int j = 0; j < vertex->numAdj; j++)
+        {
+            Node* target = vertex->adjacents[j];
+            target->incoming[target->numIncoming++] = vertex;
+        }
+    }
+
+    releaseArrays(g);
+    g->numRows = 0;
+    g->numCols = 0;
+    g->storage = STORAGE_NODES;
+}
+#pragma endregion
+
+#pragma region Highest Sum Cache
+/// <summary>
+/// Struct to represent the dynamic programming tables of the last highest sum query on an acyclic graph.
+/// Vertices are referred to by their position in the topological order.
+/// </summary>
+typedef struct highestSumCache
+{
+    int startVertex;
+    int numReachable;
+    int* order;       // Vertices reachable from the start vertex, in topological order
+    int* position;    // position[v] is the index of v in order, or -1 if v is not reachable
+    int* predOffsets; // Predecessors of order[i] are predSources[predOffsets[i]] .. predSources[predOffsets[i + 1] - 1]
+    int* predSources;
+    int* best;        // Highest sum of a path from the start vertex to order[i]
+    int* pred;        // Position of the vertex before order[i] on that path, or -1
+    int* tree;        // Segment tree over best giving the first position with the highest sum
+    int treeLeaves;
+    int* dirty;       // Min-heap of the positions whose best sum must be recomputed
+    int numDirty;
+    char* queued;     // queued[i] is set while i is in the dirty heap
+} HighestSumCache;
+
+/// <summary>
+/// Function to push a position on the dirty heap of the cache
+/// </summary>
+/// <param name="c"></param>
+/// <param name="i"></param>
+static void pushDirty(HighestSumCache* c, int i)
+{
+    if (c->queued[i]) return;
+    c->queued[i] = 1;
+
+    int k = c->numDirty++;
+    while (k > 0 && c->dirty[(k - 1) / 2] > i)
+    {
+        c->dirty[k] = c->dirty[(k - 1) / 2];
+        k = (k - 1) / 2;
+    }
+    c->dirty[k] = i;
+}
+
+/// <summary>
+/// Function to drop the highest sum tables of a graph after a change to its structure
+/// </summary>
+/// <param name="g"></param>
+void invalidateHighestSumCache(Graph* g)
+{
+    HighestSumCache* c = g->cache;
+    if (!c) return;
+
+    free(c->order);
+    free(c->position);
+    free(c->predOffsets);
+    free(c->predSources);
+    free(c->best);
+    free(c->pred);
+    free(c->tree);
+    free(c->dirty);
+    free(c->queued);
+    free(c);
+    g->cache = NULL;
+}
+
+// Number of source vertices whose point to point tables are kept at once, and their total size in vertices
+#define MAX_CACHED_SOURCES 64
+#define MAX_CACHED_TABLE_VERTICES (1 << 23)
+
+/// <summary>
+/// Struct to represent the highest sum of a path from a source vertex to each vertex of an acyclic graph
+/// </summary>
+typedef struct
+{
+    int source;
+    bool acyclic;     // Without it best and pred are not filled
+    int* best;        // Highest sum of a path from the source to v
+    int* pred;        // Vertex before v on that path, -1 for the source, -2 if v cannot be reached
+    long long lastUse;
+} PathTables;
+
+/// <summary>
+/// Struct to represent the point to point tables of the last sources queried, see bestPathBetween
+/// </summary>
+typedef struct pathTableCache
+{
+    PathTables entries[MAX_CACHED_SOURCES];
+    int numEntries;
+    long long clock;  // Counts the lookups, to find the entry used least recently
+} PathTableCache;
+
+/// <summary>
+/// Function to drop the point to point tables of a graph after any change to it
+/// </summary>
+/// <param name="g"></param>
+void invalidatePathTables(Graph* g)
+{
+    PathTableCache* c = g->pathTables;
+    if (!c) return;
+
+    for (int i = 0; i < c->numEntries; i++)
+    {
+        free(c->entries[i].best);
+        free(c->entries[i].pred);
+    }
+    free(c);
+    g->pathTables = NULL;
+}
+
+/// <summary>
+/// Function to record that the value of a vertex changed, so the next query only recomputes what depends on it
+/// </summary>
+/// <param name="g"></param>
+/// <param name="v"></param>
+static void markVertexDirty(Graph* g, int v)
+{
+    invalidatePathTables(g);
+    if (g->cache && g->cache->position[v] >= 0)
+    {
+        pushDirty(g->cache, g->cache->position[v]);
+    }
+}
+#pragma endregion
+
+#pragma region Vertex
+/// <summary>
+/// Function to drop one occurrence of a source vertex from the incoming list of a vertex
+/// </summary>
+/// <param name="vertex"></param>
+/// <param name="source"></param>
+static void detachIncoming(Node* vertex, Node* source)
+{
+    for (int i = 0; i < vertex->numIncoming; i++)
+    {
+        if (vertex->incoming[i] == source)
+        {
+            // The order of the incoming list does not matter, so the last entry fills the gap
+            vertex->incoming[i] = vertex->incoming[--vertex->numIncoming];
+            return;
+        }
+    }
+}
+
+/// <summary>
+/// Function to make room for at least a given number of vertices without further reallocations
+/// </summary>
+/// <param name="g"></param>
+/// <param name="capacity"></param>
+void reserveVertices(Graph* g, int capacity)
+{
+    if (capacity <= g->size) return;
+
+    // Reallocate memory for the array of vertices
+    Node** temp = realloc(g->vertices, capacity * sizeof(Node*));
+
+    // Check if memory reallocation was successful
+    if (!temp)
+    {
+        perror("Failed to reallocate memory for vertices");
+        exit(EXIT_FAILURE);
+    }
+    g->vertices = temp;
+    g->size = capacity;
+}
+
+/// <summary>
+/// Function to make room for at least a given number of slots in a slot table
+/// </summary>
+/// <param name="slots"></param>
+/// <param name="capacity"></param>
+static void reserveSlots(SlotTable* slots, int capacity)
+{
+    if (capacity <= slots->capacity) return;
+
+    // Double the capacity so that adding vertices one by one stays amortized constant time
+    if (capacity < 2 * slots->capacity) capacity = 2 * slots->capacity;
+
+    unsigned* generation = realloc(slots->generation, capacity * sizeof(unsigned));
+    if (generation) slots->generation = generation;
+    int* prev = realloc(slots->prev, capacity * sizeof(int));
+    if (prev) slots->prev = prev;
+    int* next = realloc(slots->next, capacity * sizeof(int));
+    if (next) slots->next = next;
+
+    // Check if memory reallocation was successful
+    if (!generation || !prev || !next)
+    {
+        perror("Failed to reallocate memory for slots");
+        exit(EXIT_FAILURE);
+    }
+    slots->capacity = capacity;
+}
+
+/// <summary>
+/// Function to create the slot table of a graph, with the vertices in id order, before the first change that needs it
+/// </summary>
+/// <param name="g"></param>
+static void ensureSlots(Graph* g)
+{
+    if (g->slots) return;
+
+    SlotTable* slots = calloc(1, sizeof(SlotTable));
+    if (!slots)
+    {
+        perror("Failed to allocate memory for slots");
+        exit(EXIT_FAILURE);
+    }
+    reserveSlots(slots, g->numVertices > 0 ? g->numVertices : 1);
+
+    for (int i = 0; i < g->numVertices; i++)
+    {
+        slots->generation[i] = 0;
+        slots->prev[i] = i - 1;
+        slots->next[i] = i + 1 < g->numVertices ? i + 1 : -1;
+    }
+    slots->first = g->numVertices > 0 ? 0 : -1;
+    slots->last = g->numVertices - 1;
+    slots->freeList = -1;
+    slots->numFree = 0;
+    g->slots = slots;
+}
+
+/// <summary>
+/// Function to free a slot table
+/// </summary>
+/// <param name="slots"></param>
+static void freeSlots(SlotTable* slots)
+{
+    if (!slots) return;
+
+    free(slots->generation);
+    free(slots->prev);
+    free(slots->next);
+    free(slots);
+}
+
+/// <summary>
+/// Function to get a slot for a new vertex, reusing the slot of a removed vertex when there is one.
+/// The vertex is not linked into the start to end order.
+/// </summary>
+/// <param name="g"></param>
+/// <param name="value"></param>
+/// <returns>The id of the new vertex</returns>
+static int takeSlot(Graph* g, int value)
+{
+    SlotTable* slots = g->slots;
+
+    // Reuse the node left in a free slot
+    if (slots && slots->freeList >= 0)
+    {
+        int v = slots->freeList;
+        slots->freeList = slots->next[v];
+        slots->numFree--;
+        slots->generation[v]++;
+        g->vertices[v]->value = value;
+        return v;
+    }
+
+    // If the number of vertices is equal to the size of the array, reallocate memory
+    if (g->numVertices == g->size)
+    {
+        // Double the size of the array
+        g->size *= 2;
+        // Reallocate memory for the array of vertices
+        Node** temp = realloc(g->vertices, g->size * sizeof(Node*));
+
+        // Check if memory reallocation was successful
+        if (!temp)
+        {
+            perror("Failed to reallocate memory for vertices");
+            exit(EXIT_FAILURE);
+        }
+        g->vertices = temp;
+    }
+
+    // Create a new node
+    Node* newNode = arenaAlloc(&g->arena, sizeof(Node));
+    newNode->id = g->numVertices;
+    newNode->value = value;
+    newNode->adjacents = NULL;
+    newNode->numAdj = 0;
+    newNode->adjCapacity = 0;
+    newNode->incoming = NULL;
+    newNode->numIncoming = 0;
+    newNode->incomingCapacity = 0;
+    g->vertices[g->numVertices] = newNode;
+
+    if (slots)
+    {
+        reserveSlots(slots, g->numVertices + 1);
+        slots->generation[g->numVertices] = 0;
+    }
+    return g->numVertices++;
+}
+
+/// <summary>
+/// Function to link a vertex at the start or at the end of the start to end order
+/// </summary>
+/// <param name="slots"></param>
+/// <param name="v"></param>
+/// <param name="atStart"></param>
+static void linkSlot(SlotTable* slots, int v, bool atStart)
+{
+    if (atStart)
+    {
+        slots->prev[v] = -1;
+        slots->next[v] = slots->first;
+        if (slots->first >= 0) slots->prev[slots->first] = v;
+        else slots->last = v;
+        slots->first = v;
+    }
+    else
+    {
+        slots->next[v] = -1;
+        slots->prev[v] = slots->last;
+        if (slots->last >= 0) slots->next[slots->last] = v;
+        else slots->first = v;
+        slots->last = v;
+    }
+}
+
+/// <summary>
+/// Function to add a vertex to a graph
+/// </summary>
+/// <param name="g"></param>
+/// <param name="value"></param>
+void addVertex(Graph* g, int value)
+{
+    thawGraph(g);
+    invalidateHighestSumCache(g);
+    invalidatePathTables(g);
+
+    int v = takeSlot(g, value);
+    if (g->slots) linkSlot(g->slots, v, false);
+}
+
+/// <summary>
+/// Function to remove a vertex from a graph. The other vertices keep their ids.
+/// </summary>
+/// <param name="g"></param>
+/// <param name="vertexIndex"></param>
+void removeVertex(Graph* g, int vertexIndex)
+{
+    // Check if the vertex Index's are valid
+    if (!vertexExists(g, vertexIndex))
+    {
+        printf("Invalid vertex index.\n");
+        return;
+    }
+
+    thawGraph(g);
+    invalidateHighestSumCache(g);
+    invalidatePathTables(g);
+    ensureSlots(g);
+
+    // Get the vertex to be removed
+    Node* vertexToRemove = g->vertices[vertexIndex];
+
+    // First, remove all edges from other vertices pointing to this vertex, visiting only its predecessors
+    for (int i = 0; i < vertexToRemove->numIncoming; i++)
+    {
+        Node* vertex = vertexToRemove->incoming[i];
+        if (vertex == vertexToRemove) continue; // Skip the vertex being removed
+
+        int j = 0;
+        while (j < vertex->numAdj) {
+            if (vertex->adjacents[j] == vertexToRemove)
+            {
+                // Shift all elements to the left to overwrite the current position
+                for (int k = j; k < vertex->numAdj - 1; k++)
+                {
+                    vertex->adjacents[k] = vertex->adjacents[k + 1];
+                }
+                vertex->numAdj--; // Decrease the count of adjacents
+            }
+            else {
+                j++; // Only increment if no deletion was made to keep the index correct
+            }
+        }
+    }
+
+    // Then drop the vertex from the incoming lists of its successors
+    for (int i = 0; i < vertexToRemove->numAdj; i++)
+    {
+        if (vertexToRemove->adjacents[i] != vertexToRemove)
+        {
+            detachIncoming(vertexToRemove->adjacents[i], vertexToRemove);
+        }
+    }
+
+    // Hand the adjacent and incoming lists of the vertex to be removed back to the arena.
+    // The node itself stays in its slot, as an isolated vertex, until the slot is reused.
+    arenaReleaseList(&g->arena, vertexToRemove->adjacents, vertexToRemove->adjCapacity);
+    arenaReleaseList(&g->arena, vertexToRemove->incoming, vertexToRemove->incomingCapacity);
+    vertexToRemove->adjacents = NULL;
+    vertexToRemove->numAdj = 0;
+    vertexToRemove->adjCapacity = 0;
+    vertexToRemove->incoming = NULL;
+    vertexToRemove->numIncoming = 0;
+    vertexToRemove->incomingCapacity = 0;
+    vertexToRemove->value = 0;
+
+    // Unlink the vertex from the start to end order and put its slot on the free list
+    SlotTable* slots = g->slots;
+    int prev = slots->prev[vertexIndex];
+    int next = slots->next[vertexIndex];
+    if (prev >= 0) slots->next[prev] = next;
+    else slots->first = next;
+    if (next >= 0) slots->prev[next] = prev;
+    else slots->last = prev;
+
+    slots->generation[vertexIndex]++;
+    slots->next[vertexIndex] = slots->freeList;
+    slots->freeList = vertexIndex;
+    slots->numFree++;
+}
+
+/// <summary>
+/// Function to add a vertex at the start of the graph
+/// </summary>
+/// <param name="g"></param>
+/// <param name="value"></param>
+void addVertexAtStart(Graph* g, int value)
+{
+    thawGraph(g);
+    invalidateHighestSumCache(g);
+    invalidatePathTables(g);
+    ensureSlots(g);
+
+    // The new vertex gets a free slot and is placed first in the order, without renumbering the others
+    int v = takeSlot(g, value);
+    linkSlot(g->slots, v, true);
+}
+
+/// <summary>
+/// Function to add a vertex at the end of the graph
+/// </summary>
+/// <param name="g"></param>
+/// <param name="value"></param>
+void addVertexAtEnd(Graph* g, int value) {
+    addVertex(g, value);
+}
+
+/// <summary>
+/// Function to update the value of a vertex in a graph
+/// </summary>
+/// <param name="g"></param>
+/// <param name="vertexId"></param>
+/// <param name="newValue"></param>
+void updateVertexValue(Graph* g, int vertexId, int newValue)
+{
+    // Check if the vertex ID is valid
+    if (!vertexExists(g, vertexId)) {
+        printf("Invalid vertex ID.\n");
+        return;
+    }
+
+    markVertexDirty(g, vertexId);
+
+    // A value change does not alter the structure, so frozen and grid graphs are updated in place
+    if (g->storage != STORAGE_NODES)
+    {
+        g->values[vertexId] = newValue;
+        return;
+    }
+
+    // Update the value of the vertex
+    Node* vertex = g->vertices[vertexId];
+    vertex->value = newValue;
+}
+#pragma endregion
+
+#pragma region Edge
+/// <summary>
+/// Function to add an edge to a graph
+/// </summary>
+/// <param name="g"></param>
+/// <param name="from"></param>
+/// <param name="to"></param>
+void addEdge(Graph* g, int from, int to)
+{
+    // Check if the vertex Index's are valid
+    if (!vertexExists(g, from) || !vertexExists(g, to))
+    {
+        printf("Invalid vertex index.\n");
+        return;
+    }
+
+    thawGraph(g);
+    invalidateHighestSumCache(g);
+    invalidatePathTables(g);
+
+    // Update the list of adjacent vertices of the source vertex
+    Node* src = g->vertices[from];
+    reserveNodeList(&g->arena, &src->adjacents, &src->adjCapacity, src->numAdj + 1, false);
+    src->adjacents[src->numAdj++] = g->vertices[to];
+
+    // Record the edge in the incoming list of the target vertex
+    Node* dest = g->vertices[to];
+    reserveNodeList(&g->arena, &dest->incoming, &dest->incomingCapacity, dest->numIncoming + 1, false);
+    dest->incoming[dest->numIncoming++] = src;
+}
+
+/// <summary>
+/// Function to add many edges to a graph at once. The adjacency and incoming lists are counted first and grown
+/// only once each, so loading a large edge list costs a single reallocation per vertex.
+/// Nothing is added if any edge refers to an invalid vertex.
+/// </summary>
+/// <param name="g"></param>
+/// <param name="edges">Pairs of source and destination vertex ids</param>
+/// <param name="n">Number of edges</param>
+void addEdgesBulk(Graph* g, const int (*edges)[2], int n)
+{
+    // Check if the vertex Index's are valid
+    for (int e = 0; e < n; e++)
+    {
+        if (!vertexExists(g, edges[e][0]) || !vertexExists(g, edges[e][1]))
+        {
+            printf("Invalid vertex index.\n");
+            return;
+        }
+    }
+    if (n <= 0) return;
+
+    thawGraph(g);
+    invalidateHighestSumCache(g);
+    invalidatePathTables(g);
+
+    // Count the new outgoing and incoming edges of each vertex
+    int* extraOut = calloc(g->numVertices, sizeof(int));
+    int* extraIn = calloc(g->numVertices, sizeof(int));
+
+    // Check if memory allocation was successful
+    if (!extraOut || !extraIn)
+    {
+        perror("Failed to allocate memory for edge counts");
+        exit(EXIT_FAILURE);
+    }
+
+    for (int e = 0; e < n; e++)
+    {
+        extraOut[edges[e][0]]++;
+        extraIn[edges[e][1]]++;
+    }
+
+    // Size every list once
+    for (int i = 0; i < g->numVertices; i++)
+    {
+        Node* vertex = g->vertices[i];
+        if (extraOut[i] > 0) reserveNodeList(&g->arena, &vertex->adjacents, &vertex->adjCapacity, vertex->numAdj + extraOut[i], true);
+        if (extraIn[i] > 0) reserveNodeList(&g->arena, &vertex->incoming, &vertex->incomingCapacity, vertex->numIncoming + extraIn[i], true);
+    }
+
+    // Fill them in the order the edges were given
+    for (int e = 0; e < n; e++)
+    {
+        Node* src = g->vertices[edges[e][0]];
+        Node* dest = g->vertices[edges[e][1]];
+        src->adjacents[src->numAdj++] = dest;
+        dest->incoming[dest->numIncoming++] = src;
+    }
+
+    free(extraOut);
+    free(extraIn);
+}
+
+/// <summary>
+/// Function to remove an edge from a graph
+/// </summary>
+/// <param name="g"></param>
+/// <param name="from"></param>
+/// <param name="to"></param>
+/// <returns>true if the edge was found and removed</returns>
+bool removeEdge(Graph* g, int from, int to)
+{
+    // Check if the vertex Index's are valid
+    if (!vertexExists(g, from) || !vertexExists(g, to))
+    {
+        printf("Invalid vertex index.\n");
+        return false;
+    }
+
+    // Look the edge up in the current storage first, so removing a missing edge leaves a frozen or grid graph as it is
+    int numAdj = vertexDegree(g, from);
+    int i = 0;
+    while (i < numAdj && vertexAdjacent(g, from, i) != to) i++;
+    if (i == numAdj) return false;
+
+    // Thawing keeps the order of the adjacents, so the edge is still at index i
+    thawGraph(g);
+    invalidateHighestSumCache(g);
+    invalidatePathTables(g);
+
+    Node* src = g->vertices[from]; // Get the source vertex
+
+    // Remove the edge by shifting left the elements in the adjacency array
+    for (int j = i; j < src->numAdj - 1; j++)
+    {
+        src->adjacents[j] = src->adjacents[j + 1];
+    }
+
+    src->numAdj--; // Decrease the count of adjacents, the capacity is kept for later additions
+    detachIncoming(g->vertices[to], src);
+    return true;
+}
+#pragma endregion
+
+#pragma region Graph Functions
+/// <summary>
+/// Function to create a new graph
+/// </summary>
+/// <param name="initialSize"></param>
+/// <returns></returns>
+Graph* createGraph(int initialSize)
+{
+    // Allocate memory for the graph
+    Graph* g = malloc(sizeof(Graph));
+
+    // Check if memory allocation was successful
+    if (!g)
+    {
+        perror("Failed to allocate memory for graph");
+        exit(EXIT_FAILURE);
+    }
+
+    // Allocate memory for the array of vertices
+    g->vertices = malloc(initialSize * sizeof(Node*));
+
+    // Check if memory allocation was successful
+    if (!g->vertices)
+    {
+        free(g); // Clean up previously allocated graph memory before exiting
+        perror("Failed to allocate memory for vertices");
+        exit(EXIT_FAILURE);
+    }
+
+    g->numVertices = 0;
+    g->size = initialSize;
+    g->slots = NULL;
+    memset(&g->arena, 0, sizeof(g->arena));
+    g->storage = STORAGE_NODES;
+    g->offsets = NULL;
+    g->targets = NULL;
+    g->values = NULL;
+    g->inOffsets = NULL;
+    g->inSources = NULL;
+    g->numRows = 0;
+    g->numCols = 0;
+    g->stencil = STENCIL_RIGHT_DOWN;
+    g->snapshot = NULL;
+    g->cache = NULL;
+    g->pathTables = NULL;
+    g->wavefrontStart = -1;
+
+    return g;
+}
+
+/// <summary>
+/// Function to free the memory allocated for the graph
+/// </summary>
+/// <param name="g"></param>
+void freeGraph(Graph* g)
+{
+    invalidateHighestSumCache(g);
+    invalidatePathTables(g);
+
+    // Frozen and grid graphs keep everything in a few arrays
+    if (g->storage != STORAGE_NODES)
+    {
+        releaseArrays(g);
+        g->numVertices = 0;
+    }
+
+    // Free the memory allocated for the vertices, all of it held by the arena
+    arenaRelease(&g->arena);
+
+    freeSlots(g->slots);
+    free(g->vertices);
+    free(g);
+}
+
+/// <summary>
+/// Function to read the values of a matrix file (one row per line, values separated by ';') in a single pass
+/// over a memory mapping of the file. Rows may have any width but must all have the same number of values.
+/// </summary>
+/// <param name="filename"></param>
+/// <param name="numRows"></param>
+/// <param name="numCols"></param>
+/// <returns>Array with the numRows * numCols values in row order, to be freed by the caller</returns>
+int* readMatrixFile(const char* filename, int* numRows, int* numCols)
+{
+    MappedFile mf;
+
+    // Map the file into memory
+    if (!mapFile(filename, &mf, false))
+    {
+        perror("File not found");
+        exit(EXIT_FAILURE);
+    }
+
+#ifndef _WIN32
+    // The file is read front to back
+    if (mf.data) madvise(mf.data, mf.size, MADV_SEQUENTIAL);
+#endif
+
+    size_t capacity = 1024;
+    size_t numValues = 0;
+    int* values = malloc(capacity * sizeof(int));
+    int col = 0;
+    *numRows = 0;
+    *numCols = 0;
+
+    // Check if memory allocation was successful
+    if (!values)
+    {
+        perror("Failed to allocate memory for matrix values");
+        exit(EXIT_FAILURE);
+    }
+
+    const char* p = mf.data;
+    const char* end = mf.data + mf.size;
+    while (p <= end)
+    {
+        // End of a line (or of the file): close the current row
+        if (p == end || *p == '\n')
+        {
+            if (col > 0)
+            {
+                if (*numRows == 0)
+                {
+                    // The first row sets the width and gives an estimate of the total number of values
+                    *numCols = col;
+                    size_t estimate = (mf.size / (size_t)(p - mf.data + 1) + 1) * (size_t)col;
+                    if (estimate > capacity)
+                    {
+                        int* temp = realloc(values, estimate * sizeof(int));
+                        if (temp)
+                        {
+                            values = temp;
+                            capacity = estimate;
+                        }
+                    }
+                }
+                else if (col != *numCols)
+                {
+                    fprintf(stderr, "Row %d of %s has %d values, expected %d\n", *numRows + 1, filename, col, *numCols);
+                    exit(EXIT_FAILURE);
+                }
+                (*numRows)++;
+                col = 0;
+            }
+            p++;
+            continue;
+        }
+
+        // Skip separators and blanks
+        if (*p == ';' || *p == ' ' || *p == '\t' || *p == '\r')
+        {
+            p++;
+            continue;
+        }
+
+        // Parse an integer
+        bool negative = false;
+        if (*p == '-' || *p == '+')
+        {
+            negative = *p == '-';
+            p++;
+        }
+        if (p == end || *p < '0' || *p > '9')
+        {
+            fprintf(stderr, "Invalid value in row %d of %s\n", *numRows + 1, filename);
+            exit(EXIT_FAILURE);
+        }
+        unsigned int value = 0;
+        while (p < end && *p >= '0' && *p <= '9')
+        {
+            value = value * 10 + (unsigned int)(*p++ - '0');
+        }
+
+        // Grow the array if the estimate was too small
+        if (numValues == capacity)
+        {
+            capacity *= 2;
+            int* temp = realloc(values, capacity * sizeof(int));
+            if (!temp)
+            {
+                perror("Failed to reallocate memory for matrix values");
+                exit(EXIT_FAILURE);
+            }
+            values = temp;
+        }
+        values[numValues++] = negative ? -(int)value : (int)value;
+        col++;
+    }
+    unmapFile(&mf);
+
+    // Give back what the estimate reserved in excess
+    if (numValues > 0 && numValues < capacity)
+    {
+        int* temp = realloc(values, numValues * sizeof(int));
+        if (temp) values = temp;
+    }
+
+    return values;
+}
+
+/// <summary>
+/// Function to load a graph from a file
+/// </summary>
+/// <param name="g"></param>
+/// <param name="filename"></param>
+void loadMatrixFromFile(Graph* g, const char* filename)
+{
+    int numRows, numCols;
+    int* values = readMatrixFile(filename, &numRows, &numCols);
+    int numValues = numRows * numCols;
+
+    // Add the vertices to the graph, all in one allocation
+    reserveVertices(g, g->numVertices + numValues);
+    for (int i = 0; i < numValues; i++)
+    {
+        addVertex(g, values[i]);
+    }
+    free(values);
+
+    // Canno't create a connection between the vertices in diagonal
+    // Connect the vertices in the graph
+    int (*edges)[2] = malloc((2 * (size_t)numValues + 1) * sizeof(*edges));
+    if (!edges)
+    {
+        perror("Failed to allocate memory for edges");
+        exit(EXIT_FAILURE);
+    }
+
+    int numEdges = 0;
+    for (int i = 0; i < g->numVertices; i++)
+    {
+        int row = i / numCols;
+        int col = i % numCols;
+
+        // Connect to the right
+        if (col < numCols - 1)
+        {
+            edges[numEdges][0] = i;
+            edges[numEdges++][1] = i + 1;
+        }
+        // Connect to the bottom
+        if (row < numRows - 1)
+        {
+            edges[numEdges][0] = i;
+            edges[numEdges++][1] = i + numCols;
+        }
+    }
+    addEdgesBulk(g, (const int (*)[2])edges, numEdges);
+    free(edges);
+}
+
+/// <summary>
+/// Function to load a matrix file as a grid graph, which keeps only the values and derives the edges from the stencil.
+/// The graph must be empty; it is turned into nodes by the first structural change. Matrices of more than INT_MAX cells
+/// are rejected, since the vertex ids are ints.
+/// </summary>
+/// <param name="g"></param>
+/// <param name="filename"></param>
+/// <param name="stencil"></param>
+void loadMatrixAsGrid(Graph* g, const char* filename, GridStencil stencil)
+{
+    // Check if the graph is empty
+    if (g->numVertices > 0)
+    {
+        printf("The graph must be empty to load a grid.\n");
+        return;
+    }
+
+    int numRows, numCols;
+    int* values = readMatrixFile(filename, &numRows, &numCols);
+
+    // Vertex ids are ints, so larger matrices can only be solved with streamHighestSum
+    if ((long long)numRows * numCols > INT_MAX)
+    {
+        fprintf(stderr, "%s has %d x %d cells, more than the %d a graph can hold; use --stream for it\n", filename,
+            numRows, numCols, INT_MAX);
+        exit(EXIT_FAILURE);
+    }
+
+    // Release the empty storage the graph was created with
+    releaseArrays(g);
+
+    g->values = values;
+    g->numVertices = numRows * numCols;
+    g->numRows = numRows;
+    g->numCols = numCols;
+    g->stencil = stencil;
+    g->storage = STORAGE_GRID;
+}
+
+// Size of the buffer output files are formatted into before each write
+#define OUTPUT_BUFFER_SIZE (1 << 20)
+
+/// <summary>
+/// Struct to format text into a large buffer that is written to a file in chunks
+/// </summary>
+typedef struct
+{
+    FILE* file;
+    char* data;
+    size_t used;
+    bool failed; // Set once a write fails
+} OutputBuffer;
+
+/// <summary>
+/// Function to start buffering the output to a file
+/// </summary>
+/// <param name="ob"></param>
+/// <param name="file"></param>
+void outputBegin(OutputBuffer* ob, FILE* file)
+{
+    ob->file = file;
+    ob->data = malloc(OUTPUT_BUFFER_SIZE);
+    ob->used = 0;
+    ob->failed = false;
+
+    // Check if memory allocation was successful
+    if (!ob->data)
+    {
+        perror("Failed to allocate memory for output buffer");
+        exit(EXIT_FAILURE);
+    }
+}
+
+/// <summary>
+/// Function to write the buffered text to the file
+/// </summary>
+/// <param name="ob"></param>
+void outputFlush(OutputBuffer* ob)
+{
+    if (ob->used > 0 && fwrite(ob->data, 1, ob->used, ob->file) != ob->used)
+    {
+        ob->failed = true;
+    }
+    ob->used = 0;
+}
+
+/// <summary>
+/// Function to write the remaining text and release the buffer (the file stays open)
+/// </summary>
+/// <param name="ob"></param>
+/// <returns>true if everything was written</returns>
+bool outputEnd(OutputBuffer* ob)
+{
+    outputFlush(ob);
+    free(ob->data);
+    ob->data = NULL;
+    return !ob->failed;
+}
+
+/// <summary>
+/// Function to append text to the buffer
+/// </summary>
+/// <param name="ob"></param>
+/// <param name="text"></param>
+void outputText(OutputBuffer* ob, const char* text)
+{
+    size_t length = strlen(text);
+    if (OUTPUT_BUFFER_SIZE - ob->used < length)
+    {
+        outputFlush(ob);
+
+        // Text longer than the whole buffer is written directly
+        if (length > OUTPUT_BUFFER_SIZE)
+        {
+            ob->failed = ob->failed || fwrite(text, 1, length, ob->file) != length;
+            return;
+        }
+    }
+    memcpy(ob->data + ob->used, text, length);
+    ob->used += length;
+}
+
+/// <summary>
+/// Function to append an integer in decimal to the buffer
+/// </summary>
+/// <param name="ob"></param>
+/// <param name="value"></param>
+void outputInt(OutputBuffer* ob, long long value)
+{
+    if (OUTPUT_BUFFER_SIZE - ob->used < 24) outputFlush(ob);
+
+    // Write the digits backwards into a scratch area, then copy them in order
+    char digits[24];
+    int n = 0;
+    unsigned long long magnitude = value < 0 ? 0ULL - (unsigned long long)value : (unsigned long long)value;
+    do
+    {
+        digits[n++] = (char)('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude > 0);
+
+    char* out = ob->data + ob->used;
+    if (value < 0) *out++ = '-';
+    while (n > 0) *out++ = digits[--n];
+    ob->used = out - ob->data;
+}
+
+/// <summary>
+/// Colours used to highlight ranked paths in DOT files, best path first
+/// </summary>
+static const char* pathColors[] = { "red", "blue", "green3", "orange", "purple", "brown", "magenta", "cyan3", "gold", "gray40" };
+#define NUM_PATH_COLORS (int)(sizeof(pathColors) / sizeof(pathColors[0]))
+
+/// <summary>
+/// Function to generate a DOT file from a graph, highlighting several ranked paths with distinct colours.
+/// An edge shared by several paths gets the colour of the best ranked one.
+/// The path edges are indexed by source vertex first, so each graph edge is looked up in the few path edges
+/// leaving its source instead of in every path.
+/// </summary>
+/// <param name="g"></param>
+/// <param name="filename"></param>
+/// <param name="paths">numPaths paths, path r starting at paths[r * g->numVertices], as filled by topKPaths</param>
+/// <param name="pathLens"></param>
+/// <param name="numPaths"></param>
+void generateDotFileWithPaths(Graph* g, const char* filename, const int paths[], const int pathLens[], int numPaths)
+{
+    double start = statsPhaseBegin();
+
+    // Open the file
+    FILE* file = fopen(filename, "w");
+
+    // Check if the file was opened successfully
+    if (!file)
+    {
+        perror("Unable to create file");
+        exit(EXIT_FAILURE);
+    }
+
+    // List the path edges leaving each vertex: firstMark[u] starts a chain of (markTarget, markRank) entries
+    int numMarks = 0;
+    for (int r = 0; r < numPaths; r++)
+    {
+        if (pathLens[r] > 1) numMarks += pathLens[r] - 1;
+    }
+    int* firstMark = malloc((g->numVertices > 0 ? g->numVertices : 1) * sizeof(int));
+    int* markTarget = malloc((numMarks > 0 ? numMarks : 1) * sizeof(int));
+    int* markRank = malloc((numMarks > 0 ? numMarks : 1) * sizeof(int));
+    int* markNext = malloc((numMarks > 0 ? numMarks : 1) * sizeof(int));
+
+    // Check if memory allocation was successful
+    if (!firstMark || !markTarget || !markRank || !markNext)
+    {
+        perror("Failed to allocate memory for path edges");
+        exit(EXIT_FAILURE);
+    }
+
+    for (int i = 0; i < g->numVertices; i++)
+    {
+        firstMark[i] = -1;
+    }
+
+    // Add the worst ranked paths first, so the best ranked entry for an edge ends up first in its chain
+    int mark = 0;
+    for (int r = numPaths - 1; r >= 0; r--)
+    {
+        const int* path = paths + (size_t)r * g->numVertices;
+        for (int k = 0; k < pathLens[r] - 1; k++)
+        {
+            markTarget[mark] = path[k + 1];
+            markRank[mark] = r;
+            markNext[mark] = firstMark[path[k]];
+            firstMark[path[k]] = mark++;
+        }
+    }
+
+    OutputBuffer ob;
+    outputBegin(&ob, file);
+
+    // Write the graph to the file
+    outputText(&ob, "digraph G {\n");
+
+    // Output all vertices
+    for (int i = firstVertex(g); i >= 0; i = nextVertex(g, i))
+    {
+        outputText(&ob, "    ");
+        outputInt(&ob, i);
+        outputText(&ob, " [label=\"");
+        outputInt(&ob, vertexValue(g, i));
+        outputText(&ob, "\"];\n");
+    }
+
+    // Output all edges with the colour of the best path using them
+    for (int i = firstVertex(g); i >= 0; i = nextVertex(g, i))
+    {
+        int numAdj = vertexDegree(g, i);
+        for (int j = 0; j < numAdj; j++)
+        {
+            int adj = vertexAdjacent(g, i, j);
+            int rank = -1;
+            for (int m = firstMark[i]; m >= 0; m = markNext[m])
+            {
+                if (markTarget[m] == adj)
+                {
+                    rank = markRank[m];
+                    break;
+                }
+            }
+
+            outputText(&ob, "    ");
+            outputInt(&ob, i);
+            outputText(&ob, " -> ");
+            outputInt(&ob, adj);
+            if (rank >= 0)
+            {
+                outputText(&ob, " [color=");
+                outputText(&ob, pathColors[rank % NUM_PATH_COLORS]);
+                outputText(&ob, "];\n");
+            }
+            else
+            {
+                outputText(&ob, ";\n");
+            }
+        }
+    }
+
+    outputText(&ob, "}\n");
+    bool ok = outputEnd(&ob);
+    ok = (fclose(file) == 0) && ok;
+    if (!ok)
+    {
+        perror("Failed to write file");
+    }
+
+    free(firstMark);
+    free(markTarget);
+    free(markRank);
+    free(markNext);
+    statsPhaseEnd(PHASE_EXPORT, start);
+}
+
+/// <summary>
+/// Function to generate a DOT file from a graph, highlighting the best path in red
+/// </summary>
+/// <param name="g"></param>
+/// <param name="filename"></param>
+void generateDotFile(Graph* g, const char* filename, int bestPath[], int bestPathLen)
+{
+    generateDotFileWithPaths(g, filename, bestPath, &bestPathLen, bestPath ? 1 : 0);
+}
+
+/// <summary>
+/// Function to print the graph to the console
+/// </summary>
+/// <param name="g">Pointer to the graph</param>
+void printGraph(Graph* g)
+{
+    // Print each vertex and its adjacent vertices, from the start to the end of the graph
+    for (int i = firstVertex(g); i >= 0; i = nextVertex(g, i))
+    {
+        // Get the vertex
+        int numAdj = vertexDegree(g, i);
+        printf("Vertex %d (Value %d): ", i + 1, vertexValue(g, i));
+
+        // Print the adjacent vertices
+        if (numAdj > 0)
+        {
+            printf("-> ");
+            for (int j = 0; j < numAdj; j++)
+            {
+                int adj = vertexAdjacent(g, i, j);
+                printf("%d (Value %d)", adj + 1, vertexValue(g, adj));
+                if (j < numAdj - 1)
+                    printf(", ");
+            }
+        }
+        else
+        {
+            printf("No connections");
+        }
+        printf("\n");
+    }
+}
+#pragma endregion
+
+#pragma region Binary Snapshot
+// Snapshot layout, every field little-endian:
+//   header   "EDAG", version, kind, numVertices, numEdges, numRows, numCols, stencil (uint32 each), checksum (uint64)
+//   payload  values[numVertices], then for SNAPSHOT_CSR offsets[numVertices + 1] and targets[numEdges] (int32 each)
+// SNAPSHOT_SLOTS is SNAPSHOT_CSR for a graph with a slot table: the numRows field holds the number of vertices in use,
+// and their ids follow the targets in start to end order; the other slots are free and have no edges.
+// The checksum covers the header fields from the version to the stencil, then the payload.
+#define SNAPSHOT_VERSION 2
+#define SNAPSHOT_HEADER_SIZE 40
+#define SNAPSHOT_CSR 1
+#define SNAPSHOT_GRID 2
+#define SNAPSHOT_SLOTS 3
+
+/// <summary>
+/// Struct to accumulate the checksum of a snapshot payload (a Fletcher-style sum over 32-bit words)
+/// </summary>
+typedef struct
+{
+    uint64_t a;
+    uint64_t b;
+} Checksum;
+
+/// <summary>
+/// Function to check if the machine stores integers little-endian, like the snapshot files
+/// </summary>
+/// <returns></returns>
+static bool hostIsLittleEndian(void)
+{
+    const uint32_t one = 1;
+    return *(const unsigned char*)&one == 1;
+}
+
+/// <summary>
+/// Function to reverse the bytes of a 32-bit word
+/// </summary>
+/// <param name="w"></param>
+/// <returns></returns>
+static uint32_t swapWord(uint32_t w)
+{
+    return (w >> 24) | ((w >> 8) & 0xFF00) | ((w << 8) & 0xFF0000) | (w << 24);
+}
+
+/// <summary>
+/// Function to add words, already in host order, to a checksum
+/// </summary>
+/// <param name="c"></param>
+/// <param name="words"></param>
+/// <param name="count"></param>
+static void checksumUpdate(Checksum* c, const uint32_t* words, size_t count)
+{
+    uint64_t a = c->a, b = c->b;
+    for (size_t i = 0; i < count; i++)
+    {
+        a += words[i];
+        b += a;
+    }
+    c->a = a;
+    c->b = b;
+}
+
+/// <summary>
+/// Function to write an int array to a snapshot in little-endian order and add it to the checksum
+/// </summary>
+/// <param name="file"></param>
+/// <param name="array"></param>
+/// <param name="count"></param>
+/// <param name="c"></param>
+/// <returns>true if everything was written</returns>
+static bool writeWords(FILE* file, const int* array, size_t count, Checksum* c)
+{
+    const uint32_t* words = (const uint32_t*)array;
+    checksumUpdate(c, words, count);
+
+    if (hostIsLittleEndian())
+    {
+        return fwrite(words, sizeof(uint32_t), count, file) == count;
+    }
+
+    // Swap through a small buffer on big-endian machines
+    uint32_t buffer[1024];
+    for (size_t i = 0; i < count; i += 1024)
+    {
+        size_t n = count - i < 1024 ? count - i : 1024;
+        for (size_t j = 0; j < n; j++)
+        {
+            buffer[j] = swapWord(words[i + j]);
+        }
+        if (fwrite(buffer, sizeof(uint32_t), n, file) != n) return false;
+    }
+    return true;
+}
+
+/// <summary>
+/// Function to store a 32-bit value at the given position of a header in little-endian order
+/// </summary>
+/// <param name="header"></param>
+/// <param name="offset"></param>
+/// <param name="value"></param>
+static void putHeaderWord(unsigned char header[], int offset, uint32_t value)
+{
+    for (int i = 0; i < 4; i++)
+    {
+        header[offset + i] = (unsigned char)(value >> (8 * i));
+    }
+}
+
+/// <summary>
+/// Function to read a little-endian 32-bit value from the given position of a header
+/// </summary>
+/// <param name="header"></param>
+/// <param name="offset"></param>
+/// <returns></returns>
+static uint32_t getHeaderWord(const unsigned char header[], int offset)
+{
+    uint32_t value = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        value |= (uint32_t)header[offset + i] << (8 * i);
+    }
+    return value;
+}
+
+/// <summary>
+/// Function to add the header fields from the version to the stencil to a checksum
+/// </summary>
+/// <param name="c"></param>
+/// <param name="header"></param>
+static void checksumHeader(Checksum* c, const unsigned char header[])
+{
+    uint32_t fields[7];
+    for (int i = 0; i < 7; i++)
+    {
+        fields[i] = getHeaderWord(header, 4 + 4 * i);
+    }
+    checksumUpdate(c, fields, 7);
+}
+
+/// <summary>
+/// Function to move the arrays of a graph loaded from a snapshot into memory owned by the graph, releasing the mapping
+/// </summary>
+/// <param name="g"></param>
+void detachSnapshot(Graph* g)
+{
+    if (!g->snapshot) return;
+
+    int numEdges = g->storage == STORAGE_FROZEN ? g->offsets[g->numVertices] : 0;
+    int* values = malloc((g->numVertices > 0 ? g->numVertices : 1) * sizeof(int));
+    int* offsets = NULL;
+    int* targets = NULL;
+    if (g->storage == STORAGE_FROZEN)
+    {
+        offsets = malloc((g->numVertices + 1) * sizeof(int));
+        targets = malloc((numEdges > 0 ? numEdges : 1) * sizeof(int));
+    }
+
+    // Check if memory allocation was successful
+    if (!values || (g->storage == STORAGE_FROZEN && (!offsets || !targets)))
+    {
+        perror("Failed to allocate memory for graph arrays");
+        exit(EXIT_FAILURE);
+    }
+
+    memcpy(values, g->values, g->numVertices * sizeof(int));
+    if (offsets)
+    {
+        memcpy(offsets, g->offsets, (g->numVertices + 1) * sizeof(int));
+        memcpy(targets, g->targets, numEdges * sizeof(int));
+    }
+
+    releaseArrays(g);
+    g->values = values;
+    g->offsets = offsets;
+    g->targets = targets;
+}
+
+/// <summary>
+/// Function to save a graph to a binary snapshot file. Node graphs are frozen first.
+/// The file is written next to the destination and then renamed over it, so a failed save keeps the previous snapshot.
+/// </summary>
+/// <param name="g"></param>
+/// <param name="filename"></param>
+/// <returns>true if the snapshot was saved</returns>
+bool saveGraphBinary(Graph* g, const char* filename)
+{
+    freezeGraph(g);
+
+    // The snapshot being replaced may be the one the graph is mapped from
+    detachSnapshot(g);
+
+    char tempName[1024];
+    snprintf(tempName, sizeof(tempName), "%s.tmp", filename);
+
+    // Open the file
+    FILE* file = fopen(tempName, "wb");
+
+    // Check if the file was opened successfully
+    if (!file)
+    {
+        perror("Unable to create snapshot file");
+        return false;
+    }
+
+    bool grid = g->storage == STORAGE_GRID;
+    int numEdges = grid ? 0 : g->offsets[g->numVertices];
+    unsigned char header[SNAPSHOT_HEADER_SIZE] = { 'E', 'D', 'A', 'G' };
+    putHeaderWord(header, 4, SNAPSHOT_VERSION);
+    putHeaderWord(header, 8, grid ? SNAPSHOT_GRID : g->slots ? SNAPSHOT_SLOTS : SNAPSHOT_CSR);
+    putHeaderWord(header, 12, (uint32_t)g->numVertices);
+    putHeaderWord(header, 16, (uint32_t)numEdges);
+    putHeaderWord(header, 20, grid ? (uint32_t)g->numRows : g->slots ? (uint32_t)vertexCount(g) : 0);
+    putHeaderWord(header, 24, grid ? (uint32_t)g->numCols : 0);
+    putHeaderWord(header, 28, grid ? (uint32_t)g->stencil : 0);
+
+    // Write a placeholder header, then the payload, then the header again with the checksum
+    Checksum c = { 0, 0 };
+    checksumHeader(&c, header);
+    bool ok = fwrite(header, 1, SNAPSHOT_HEADER_SIZE, file) == SNAPSHOT_HEADER_SIZE;
+    ok = ok && writeWords(file, g->values, g->numVertices, &c);
+    if (!grid)
+    {
+        ok = ok && writeWords(file, g->offsets, (size_t)g->numVertices + 1, &c);
+        ok = ok && writeWords(file, g->targets, numEdges, &c);
+    }
+    if (!grid && g->slots)
+    {
+        // Write the ids of the vertices in use, in start to end order
+        int buffer[1024];
+        int n = 0;
+        for (int v = firstVertex(g); v >= 0 && ok; v = nextVertex(g, v))
+        {
+            buffer[n++] = v;
+            if (n == 1024 || nextVertex(g, v) < 0)
+            {
+                ok = writeWords(file, buffer, n, &c);
+                n = 0;
+            }
+        }
+    }
+
+    uint64_t checksum = c.a ^ (c.b << 32 | c.b >> 32);
+    putHeaderWord(header, 32, (uint32_t)checksum);
+    putHeaderWord(header, 36, (uint32_t)(checksum >> 32));
+    ok = ok && fseek(file, 0, SEEK_SET) == 0;
+    ok = ok && fwrite(header, 1, SNAPSHOT_HEADER_SIZE, file) == SNAPSHOT_HEADER_SIZE;
+    ok = (fclose(file) == 0) && ok;
+
+    // Replace the previous snapshot
+#ifdef _WIN32
+    ok = ok && MoveFileExA(tempName, filename, MOVEFILE_REPLACE_EXISTING);
+#else
+    ok = ok && rename(tempName, filename) == 0;
+#endif
+    if (!ok)
+    {
+        perror("Failed to write snapshot file");
+        remove(tempName);
+    }
+    return ok;
+}
+
+/// <summary>
+/// Function to load a graph from a binary snapshot file. The arrays are used in place from a copy-on-write
+/// mapping of the file, so no memory is allocated per vertex; the graph must be empty.
+/// </summary>
+/// <param name="g"></param>
+/// <param name="filename"></param>
+/// <returns>true if the snapshot was loaded, false if it is missing or invalid</returns>
+bool loadGraphBinary(Graph* g, const char* filename)
+{
+    // Check if the graph is empty
+    if (g->numVertices > 0)
+    {
+        printf("The graph must be empty to load a snapshot.\n");
+        return false;
+    }
+
+    MappedFile* mf = malloc(sizeof(MappedFile));
+    if (!mf)
+    {
+        perror("Failed to allocate memory for snapshot");
+        exit(EXIT_FAILURE);
+    }
+    if (!mapFile(filename, mf, true))
+    {
+        free(mf);
+        return false;
+    }
+
+    // Check the header
+    const unsigned char* header = (const unsigned char*)mf->data;
+    bool valid = mf->size >= SNAPSHOT_HEADER_SIZE && memcmp(header, "EDAG", 4) == 0
+        && getHeaderWord(header, 4) == SNAPSHOT_VERSION;
+    uint32_t kind = valid ? getHeaderWord(header, 8) : 0;
+    uint64_t numVertices = valid ? getHeaderWord(header, 12) : 0;
+    uint64_t numEdges = valid ? getHeaderWord(header, 16) : 0;
+    uint64_t numRows = valid ? getHeaderWord(header, 20) : 0;
+    uint64_t numCols = valid ? getHeaderWord(header, 24) : 0;
+    uint32_t stencil = valid ? getHeaderWord(header, 28) : 0;
+
+    uint64_t numWords = numVertices;
+    if (kind == SNAPSHOT_CSR)
+    {
+        numWords += numVertices + 1 + numEdges;
+    }
+    else if (kind == SNAPSHOT_SLOTS)
+    {
+        valid = valid && numRows <= numVertices;
+        numWords += numVertices + 1 + numEdges + numRows;
+    }
+    else if (kind == SNAPSHOT_GRID)
+    {
+        valid = valid && numRows * numCols == numVertices && stencil <= STENCIL_RIGHT_DOWN_DIAGONAL;
+    }
+    else
+    {
+        valid = false;
+    }
+    valid = valid && numVertices <= INT32_MAX && numEdges <= INT32_MAX
+        && mf->size == SNAPSHOT_HEADER_SIZE + numWords * sizeof(uint32_t);
+
+    // Bring the payload to host order (only needed on big-endian machines) and verify the checksum
+    uint32_t* words = valid ? (uint32_t*)(mf->data + SNAPSHOT_HEADER_SIZE) : NULL;
+    if (valid)
+    {
+        if (!hostIsLittleEndian())
+        {
+            for (uint64_t i = 0; i < numWords; i++)
+            {
+                words[i] = swapWord(words[i]);
+            }
+        }
+
+        Checksum c = { 0, 0 };
+        checksumHeader(&c, header);
+        checksumUpdate(&c, words, (size_t)numWords);
+        uint64_t checksum = c.a ^ (c.b << 32 | c.b >> 32);
+        valid = checksum == ((uint64_t)getHeaderWord(header, 36) << 32 | getHeaderWord(header, 32));
+    }
+
+    // The edges must stay inside the graph
+    if (valid && kind != SNAPSHOT_GRID)
+    {
+        const uint32_t* offsets = words + numVertices;
+        const uint32_t* targets = offsets + numVertices + 1;
+        valid = offsets[0] == 0 && offsets[numVertices] == numEdges;
+        for (uint64_t i = 0; valid && i < numVertices; i++)
+        {
+            valid = offsets[i] <= offsets[i + 1];
+        }
+        for (uint64_t i = 0; valid && i < numEdges; i++)
+        {
+            valid = targets[i] < numVertices;
+        }
+    }
+
+    // Rebuild the slot table from the vertices in use, which must be distinct slots
+    SlotTable* slots = NULL;
+    if (valid && kind == SNAPSHOT_SLOTS)
+    {
+        const uint32_t* used = words + 2 * numVertices + 1 + numEdges;
+        slots = calloc(1, sizeof(SlotTable));
+        if (!slots)
+        {
+            perror("Failed to allocate memory for slots");
+            exit(EXIT_FAILURE);
+        }
+        reserveSlots(slots, numVertices > 0 ? (int)numVertices : 1);
+
+        // Every slot starts out free
+        for (uint64_t i = 0; i < numVertices; i++)
+        {
+            slots->generation[i] = 1;
+        }
+        slots->first = -1;
+        slots->last = -1;
+        for (uint64_t i = 0; valid && i < numRows; i++)
+        {
+            valid = used[i] < numVertices && slots->generation[used[i]] == 1;
+            if (valid)
+            {
+                slots->generation[used[i]] = 0;
+                linkSlot(slots, (int)used[i], false);
+            }
+        }
+
+        // Chain the remaining slots into the free list; free slots must have no edges
+        const uint32_t* offsets = words + numVertices;
+        slots->freeList = -1;
+        slots->numFree = 0;
+        for (int i = (int)numVertices - 1; valid && i >= 0; i--)
+        {
+            if (slots->generation[i] == 1)
+            {
+                valid = offsets[i] == offsets[i + 1];
+                slots->next[i] = slots->freeList;
+                slots->freeList = i;
+                slots->numFree++;
+            }
+        }
+
+        // No edge may lead to a free slot either
+        const uint32_t* targets = offsets + numVertices + 1;
+        for (uint64_t i = 0; valid && i < numEdges; i++)
+        {
+            valid = slots->generation[targets[i]] == 0;
+        }
+    }
+
+    if (!valid)
+    {
+        freeSlots(slots);
+        fprintf(stderr, "Snapshot %s is invalid or corrupted\n", filename);
+        unmapFile(mf);
+        free(mf);
+        return false;
+    }
+
+    // Point the graph at the mapped arrays
+    releaseArrays(g);
+    g->snapshot = mf;
+    g->numVertices = (int)numVertices;
+    g->values = (int*)words;
+    g->slots = slots;
+    if (kind != SNAPSHOT_GRID)
+    {
+        g->offsets = (int*)words + numVertices;
+        g->targets = g->offsets + numVertices + 1;
+        g->storage = STORAGE_FROZEN;
+    }
+    else
+    {
+        g->numRows = (int)numRows;
+        g->numCols = (int)numCols;
+        g->stencil = (GridStencil)stencil;
+        g->storage = STORAGE_GRID;
+    }
+    return true;
+}
+
+/// <summary>
+/// Function to check if a file was modified after another one (or the other one does not exist)
+/// </summary>
+/// <param name="filename"></param>
+/// <param name="otherFilename"></param>
+/// <returns></returns>
+bool isFileNewer(const char* filename, const char* otherFilename)
+{
+    struct stat st, otherSt;
+    if (stat(filename, &st) != 0) return false;
+    if (stat(otherFilename, &otherSt) != 0) return true;
+    return st.st_mtime >= otherSt.st_mtime;
+}
+#pragma endregion
+
+#pragma region DAG
+/// <summary>
+/// Function to compute a topological order of the vertices reachable from a start vertex (Kahn's algorithm)
+/// </summary>
+/// <param name="g"></param>
+/// <param name="startVertex"></param>
+/// <param name="order">Output array with room for numVertices ids</param>
+/// <param name="orderLen">Number of reachable vertices written to order</param>
+/// <returns>true if the reachable part of the graph has no cycles, false otherwise</returns>
+bool topologicalSort(Graph* g, int startVertex, int order[], int* orderLen)
+{
+    int* inDegree = calloc(g->numVertices, sizeof(int));
+    char* reached = calloc(g->numVertices, sizeof(char));
+
+    // Check if memory allocation was successful
+    if (!inDegree || !reached)
+    {
+        perror("Failed to allocate memory for topological sort");
+        exit(EXIT_FAILURE);
+    }
+
+    // Collect the vertices reachable from the start vertex, using order as the BFS queue
+    int head = 0, tail = 0, reachable = 0;
+    order[tail++] = startVertex;
+    reached[startVertex] = 1;
+    while (head < tail)
+    {
+        int v = order[head++];
+        int numAdj = vertexDegree(g, v);
+        reachable++;
+
+        for (int i = 0; i < numAdj; i++)
+        {
+            int adj = vertexAdjacent(g, v, i);
+            inDegree[adj]++; // Only edges leaving reachable vertices are counted
+            if (!reached[adj])
+            {
+                reached[adj] = 1;
+                order[tail++] = adj;
+            }
+        }
+    }
+
+    // Repeatedly take the vertices that have no remaining incoming edges
+    head = 0;
+    tail = 0;
+    if (inDegree[startVertex] == 0)
+    {
+        order[tail++] = startVertex;
+    }
+    while (head < tail)
+    {
+        int v = order[head++];
+        int numAdj = vertexDegree(g, v);
+
+        for (int i = 0; i < numAdj; i++)
+        {
+            int adj = vertexAdjacent(g, v, i);
+            if (--inDegree[adj] == 0)
+            {
+                order[tail++] = adj;
+            }
+        }
+    }
+
+    free(inDegree);
+    free(reached);
+
+    // If some reachable vertex was never released, it lies on a cycle
+    *orderLen = tail;
+    return tail == reachable;
+}
+
+/// <summary>
+/// Function to find the highest sum path in an acyclic graph using dynamic programming over a topological order.
+/// The sum is the same as the backtracking search finds, but on ties the path may differ: this one ends at the vertex
+/// that comes first in the topological order, reached at each step from the predecessor that comes first in it.
+/// </summary>
+/// <param name="g"></param>
+/// <param name="startVertex"></param>
+/// <param name="maxSum"></param>
+/// <param name="bestPath"></param>
+/// <param name="bestPathLen"></param>
+/// <returns>true if the path was computed, false if a cycle is reachable from the start vertex</returns>
+bool dagHighestSum(Graph* g, int startVertex, int* maxSum, int bestPath[], int* bestPathLen)
+{
+    int* order = malloc(g->numVertices * sizeof(int));
+    int* best = malloc(g->numVertices * sizeof(int));
+    int* pred = malloc(g->numVertices * sizeof(int));
+    int orderLen = 0;
+
+    // Check if memory allocation was successful
+    if (!order || !best || !pred)
+    {
+        perror("Failed to allocate memory for highest sum");
+        exit(EXIT_FAILURE);
+    }
+
+    // The DP is only valid when no cycle can be reached from the start vertex
+    if (!topologicalSort(g, startVertex, order, &orderLen))
+    {
+        free(order);
+        free(best);
+        free(pred);
+        return false;
+    }
+
+    // best[v] is the highest sum of a path from the start vertex ending at v, pred[v] is the vertex before v on it
+    for (int i = 0; i < orderLen; i++)
+    {
+        pred[order[i]] = -1;
+    }
+    best[startVertex] = vertexValue(g, startVertex);
+
+    int bestEnd = -1;
+    *maxSum = 0;
+    for (int i = 0; i < orderLen; i++)
+    {
+        int v = order[i];
+        int numAdj = vertexDegree(g, v);
+
+        // A path only wins if its sum is above the current maximum, so the earliest end in the order wins ties
+        if (best[v] > *maxSum)
+        {
+            *maxSum = best[v];
+            bestEnd = v;
+        }
+
+        // Relax the outgoing edges
+        for (int j = 0; j < numAdj; j++)
+        {
+            int adj = vertexAdjacent(g, v, j);
+            int sum = best[v] + vertexValue(g, adj);
+
+            // The predecessor that comes first in the order wins ties
+            if (pred[adj] == -1 || sum > best[adj])
+            {
+                best[adj] = sum;
+                pred[adj] = v;
+            }
+        }
+    }
+
+    // Rebuild the path by following the predecessors back to the start vertex
+    *bestPathLen = 0;
+    for (int v = bestEnd; v != -1; v = pred[v])
+    {
+        bestPath[(*bestPathLen)++] = v;
+    }
+    for (int i = 0, j = *bestPathLen - 1; i < j; i++, j--)
+    {
+        int temp = bestPath[i];
+        bestPath[i] = bestPath[j];
+        bestPath[j] = temp;
+    }
+
+    free(order);
+    free(best);
+    free(pred);
+    return true;
+}
+#pragma endregion
+
+#pragma region Incremental Highest Sum
+/// <summary>
+/// Function to choose between two positions the one with the highest best sum, the earliest one on ties
+/// </summary>
+/// <param name="c"></param>
+/// <param name="a"></param>
+/// <param name="b"></param>
+/// <returns></returns>
+static int betterPosition(const HighestSumCache* c, int a, int b)
+{
+    if (a < 0) return b;
+    if (b < 0) return a;
+    if (c->best[a] != c->best[b]) return c->best[a] > c->best[b] ? a : b;
+    return a < b ? a : b;
+}
+
+/// <summary>
+/// Function to update the segment tree of the cache after the best sum of a position changed
+/// </summary>
+/// <param name="c"></param>
+/// <param name="i"></param>
+static void updateBestTree(HighestSumCache* c, int i)
+{
+    for (int node = (c->treeLeaves + i) / 2; node >= 1; node /= 2)
+    {
+        c->tree[node] = betterPosition(c, c->tree[2 * node], c->tree[2 * node + 1]);
+    }
+}
+
+/// <summary>
+/// Function to recompute the best sum and predecessor of a position from its predecessors
+/// </summary>
+/// <param name="g"></param>
+/// <param name="c"></param>
+/// <param name="i"></param>
+/// <param name="best"></param>
+/// <param name="pred"></param>
+static void recomputePosition(Graph* g, HighestSumCache* c, int i, int* best, int* pred)
+{
+    *pred = -1;
+    *best = 0;
+    statsExpand(searchStats, 0);
+
+    // Predecessors are sorted by position, so the earliest one wins ties like in dagHighestSum
+    for (int k = c->predOffsets[i]; k < c->predOffsets[i + 1]; k++)
+    {
+        int p = c->predSources[k];
+        if (*pred == -1 || c->best[p] > *best)
+        {
+            *best = c->best[p];
+            *pred = p;
+        }
+    }
+    *best += vertexValue(g, c->order[i]);
+}
+
+/// <summary>
+/// Function to build the highest sum tables for a start vertex
+/// </summary>
+/// <param name="g"></param>
+/// <param name="startVertex"></param>
+/// <returns>The new tables, or NULL if a cycle is reachable from the start vertex</returns>
+static HighestSumCache* buildHighestSumCache(Graph* g, int startVertex)
+{
+    HighestSumCache* c = calloc(1, sizeof(HighestSumCache));
+    int n = g->numVertices;
+    if (!c)
+    {
+        perror("Failed to allocate memory for highest sum tables");
+        exit(EXIT_FAILURE);
+    }
+
+    c->startVertex = startVertex;
+    c->order = malloc(n * sizeof(int));
+    c->position = malloc(n * sizeof(int));
+    c->predOffsets = calloc(n + 1, sizeof(int));
+    if (!c->order || !c->position || !c->predOffsets)
+    {
+        perror("Failed to allocate memory for highest sum tables");
+        exit(EXIT_FAILURE);
+    }
+
+    // The tables only make sense without cycles
+    g->cache = c;
+    if (!topologicalSort(g, startVertex, c->order, &c->numReachable))
+    {
+        invalidateHighestSumCache(g);
+        return NULL;
+    }
+
+    int m = c->numReachable;
+    for (int v = 0; v < n; v++)
+    {
+        c->position[v] = -1;
+    }
+    for (int i = 0; i < m; i++)
+    {
+        c->position[c->order[i]] = i;
+    }
+
+    // Build the predecessor lists (by position) from the outgoing edges
+    for (int i = 0; i < m; i++)
+    {
+        int numAdj = vertexDegree(g, c->order[i]);
+        for (int j = 0; j < numAdj; j++)
+        {
+            c->predOffsets[c->position[vertexAdjacent(g, c->order[i], j)] + 1]++;
+        }
+    }
+    for (int i = 0; i < m; i++)
+    {
+        c->predOffsets[i + 1] += c->predOffsets[i];
+    }
+
+    int* fill = malloc((m > 0 ? m : 1) * sizeof(int));
+    c->predSources = malloc((c->predOffsets[m] > 0 ? c->predOffsets[m] : 1) * sizeof(int));
+    c->best = malloc(m * sizeof(int));
+    c->pred = malloc(m * sizeof(int));
+    for (c->treeLeaves = 1; c->treeLeaves < m; c->treeLeaves *= 2);
+    c->tree = malloc(2 * c->treeLeaves * sizeof(int));
+    c->dirty = malloc(m * sizeof(int));
+    c->queued = calloc(m, sizeof(char));
+    if (!fill || !c->predSources || !c->best || !c->pred || !c->tree || !c->dirty || !c->queued)
+    {
+        perror("Failed to allocate memory for highest sum tables");
+        exit(EXIT_FAILURE);
+    }
+
+    memcpy(fill, c->predOffsets, m * sizeof(int));
+    for (int i = 0; i < m; i++)
+    {
+        int numAdj = vertexDegree(g, c->order[i]);
+        for (int j = 0; j < numAdj; j++)
+        {
+            int target = c->position[vertexAdjacent(g, c->order[i], j)];
+            c->predSources[fill[target]++] = i;
+        }
+    }
+    free(fill);
+
+    // Fill the tables in topological order
+    for (int i = 0; i < m; i++)
+    {
+        recomputePosition(g, c, i, &c->best[i], &c->pred[i]);
+    }
+    for (int i = 0; i < c->treeLeaves; i++)
+    {
+        c->tree[c->treeLeaves + i] = i < m ? i : -1;
+    }
+    for (int node = c->treeLeaves - 1; node >= 1; node--)
+    {
+        c->tree[node] = betterPosition(c, c->tree[2 * node], c->tree[2 * node + 1]);
+    }
+    c->numDirty = 0;
+
+    return c;
+}
+
+/// <summary>
+/// Function to bring the tables up to date after value changes. Positions are processed in topological order and
+/// only the successors of a position whose best sum changed are visited.
+/// </summary>
+/// <param name="g"></param>
+/// <param name="c"></param>
+static void recomputeDirty(Graph* g, HighestSumCache* c)
+{
+    while (c->numDirty > 0)
+    {
+        // Pop the earliest dirty position
+        int i = c->dirty[0];
+        int last = c->dirty[--c->numDirty];
+        int k = 0;
+        while (2 * k + 1 < c->numDirty)
+        {
+            int child = 2 * k + 1;
+            if (child + 1 < c->numDirty && c->dirty[child + 1] < c->dirty[child]) child++;
+            if (c->dirty[child] >= last) break;
+            c->dirty[k] = c->dirty[child];
+            k = child;
+        }
+        if (c->numDirty > 0) c->dirty[k] = last;
+        c->queued[i] = 0;
+
+        int best, pred;
+        recomputePosition(g, c, i, &best, &pred);
+        c->pred[i] = pred;
+        if (best == c->best[i]) continue;
+
+        c->best[i] = best;
+        updateBestTree(c, i);
+
+        // The successors depend on this best sum
+        int v = c->order[i];
+        int numAdj = vertexDegree(g, v);
+        for (int j = 0; j < numAdj; j++)
+        {
+            pushDirty(c, c->position[vertexAdjacent(g, v, j)]);
+        }
+    }
+}
+
+/// <summary>
+/// Function to find the highest sum path in an acyclic graph, keeping the tables between calls so that after
+/// updateVertexValue only the vertices downstream of the changed ones are recomputed. Structural changes drop them.
+/// </summary>
+/// <param name="g"></param>
+/// <param name="startVertex"></param>
+/// <param name="maxSum"></param>
+/// <param name="bestPath"></param>
+/// <param name="bestPathLen"></param>
+/// <returns>true if the path was computed, false if a cycle is reachable from the start vertex</returns>
+bool cachedHighestSum(Graph* g, int startVertex, int* maxSum, int bestPath[], int* bestPathLen)
+{
+    HighestSumCache* c = g->cache;
+    if (c && c->startVertex == startVertex)
+    {
+        recomputeDirty(g, c);
+    }
+    else
+    {
+        invalidateHighestSumCache(g);
+        double start = statsPhaseBegin();
+        c = buildHighestSumCache(g, startVertex);
+        statsPhaseEnd(PHASE_BUILD, start);
+        if (!c) return false;
+    }
+
+    // Same rule as the backtracking search: a path only counts if its sum is above zero
+    int end = c->tree[1];
+    *maxSum = 0;
+    *bestPathLen = 0;
+    if (end < 0 || c->best[end] <= 0) return true;
+    *maxSum = c->best[end];
+
+    // Rebuild the path by following the predecessors back to the start vertex
+    for (int i = end; i != -1; i = c->pred[i])
+    {
+        bestPath[(*bestPathLen)++] = c->order[i];
+    }
+    for (int i = 0, j = *bestPathLen - 1; i < j; i++, j--)
+    {
+        int temp = bestPath[i];
+        bestPath[i] = bestPath[j];
+        bestPath[j] = temp;
+    }
+
+    // The tables only lead to one path, the best one
+    if (searchStats && *bestPathLen > searchStats->maxDepth) searchStats->maxDepth = *bestPathLen;
+    statsPathCompleted(searchStats);
+    statsImprovement(searchStats, *maxSum);
+    return true;
+}
+#pragma endregion
+
+#pragma region Grid Wavefront
+// Grids up to this many cells switch to the highest sum tables once the same start vertex is queried twice, so that
+// value updates only recompute the affected part; larger grids always use the wavefront, which needs far less memory
+#define MAX_CACHED_GRID (1 << 22)
+// Grids from this many cells are split over all the processors
+#define MIN_PARALLEL_GRID (1 << 20)
+// Size of the tiles of a parallel wavefront, in rows (a multiple of every kernel width) and steps (at least the rows)
+#define GRID_TILE_ROWS 128
+#define GRID_TILE_STEPS 2048
+
+// Best sum given to cells outside the grid: it loses every comparison and cannot overflow when a value is added
+#define GRID_NO_SUM (INT_MIN / 2)
+
+/// <summary>
+/// Struct to represent a wavefront pass over a grid. Rows are taken in strips of one row per kernel lane; at step t
+/// lane i computes cell (i, t - i) of the strip, so every step works on one anti-diagonal. For each cell only the
+/// direction it was reached from is kept: bit i of moves[strip * steps + t] is set when cell (i, t - i) of the strip
+/// was reached from the left.
+/// </summary>
+typedef struct
+{
+    const int* values; // Cell (r, c) has the value values[r * stride + c]
+    int stride;
+    int numRows;
+    int numCols;
+    int width;         // Rows per strip
+    int numStrips;
+    int steps;         // Steps per strip, numCols + width - 1
+    unsigned char* moves;
+    int* upRow;        // Best sums of the row above the strip being computed under each column
+    int* carry;        // Results of the last step computed in each strip, one per lane
+} GridWavefront;
+
+/// <summary>
+/// Struct to represent a block of a wavefront pass: the steps firstStep .. endStep - 1 of the strips firstStrip .. endStrip - 1.
+/// Each strip runs skew steps behind the one above it, as its first row needs the last row of that strip, which is
+/// width - 1 steps late; the block ending at the last step takes every step left.
+/// </summary>
+typedef struct
+{
+    int firstStrip;
+    int endStrip;
+    int firstStep;
+    int endStep;
+    int skew;
+} GridTile;
+
+/// <summary>
+/// Struct to represent the highest cell found by a wavefront pass
+/// </summary>
+typedef struct
+{
+    int best;
+    int diagonal;
+    int row;
+} GridEnd;
+
+/// <summary>
+/// Function to offer a cell as the end of the best path. Ties go to the cell the topological order reaches first,
+/// which is the one on the earliest anti-diagonal and then on the earliest row.
+/// </summary>
+/// <param name="e"></param>
+/// <param name="sum"></param>
+/// <param name="diagonal"></param>
+/// <param name="row"></param>
+static inline void offerGridEnd(GridEnd* e, int sum, int diagonal, int row)
+{
+    if (sum > e->best || (sum == e->best && (diagonal < e->diagonal || (diagonal == e->diagonal && row < e->row))))
+    {
+        e->best = sum;
+        e->diagonal = diagonal;
+        e->row = row;
+    }
+}
+
+/// <summary>
+/// Function to get the steps a strip of a tile runs
+/// </summary>
+/// <param name="w"></param>
+/// <param name="tile"></param>
+/// <param name="strip"></param>
+/// <param name="first"></param>
+/// <param name="end"></param>
+static inline void gridTileSteps(const GridWavefront* w, GridTile tile, int strip, int* first, int* end)
+{
+    int shift = (strip - tile.firstStrip) * tile.skew;
+    *first = tile.firstStep > shift ? tile.firstStep - shift : 0;
+    *end = tile.endStep == w->steps ? w->steps : tile.endStep - shift;
+}
+
+/// <summary>
+/// Function to run a tile of the wavefront one cell at a time, for processors without SSE4.1
+/// </summary>
+/// <param name="w"></param>
+/// <param name="tile"></param>
+/// <param name="end"></param>
+static void wavefrontScalar(const GridWavefront* w, GridTile tile, GridEnd* end)
+{
+    // With one row per strip the steps are the columns
+    for (int r = tile.firstStrip; r < tile.endStrip; r++)
+    {
+        const int* values = w->values + (size_t)r * w->stride;
+        unsigned char* moves = w->moves + (size_t)r * w->steps;
+        int left = w->carry[r];
+        int first, last;
+        gridTileSteps(w, tile, r, &first, &last);
+        for (int c = first; c < last; c++)
+        {
+            int up = w->upRow[c];
+            moves[c] = left > up;
+            left = values[c] + (left > up ? left : up);
+            w->upRow[c] = left;
+            offerGridEnd(end, left, r + c, r);
+        }
+        w->carry[r] = left;
+    }
+}
+
+#ifdef GRID_SIMD
+/// <summary>
+/// Function to run a tile of the wavefront four rows at a time with SSE4.1. The left neighbour of a cell is the lane's
+/// own last result and its top neighbour the last result of the lane before it.
+/// </summary>
+/// <param name="w"></param>
+/// <param name="tile"></param>
+/// <param name="end"></param>
+TARGET_SSE41 static void wavefrontSse41(const GridWavefront* w, GridTile tile, GridEnd* end)
+{
+    const __m128i lanes = _mm_setr_epi32(0, 1, 2, 3);
+    const __m128i none = _mm_set1_epi32(GRID_NO_SUM);
+    const __m128i numCols = _mm_set1_epi32(w->numCols);
+    __m128i laneBest = none, laneDiagonal = _mm_set1_epi32(INT_MAX), laneRow = _mm_setzero_si128();
+    size_t stride = w->stride;
+    int* upRow = w->upRow;
+
+    for (int strip = tile.firstStrip; strip < tile.endStrip; strip++)
+    {
+        int r0 = strip * 4;
+        const int* rows = w->values + r0 * stride;
+        unsigned char* moves = w->moves + (size_t)strip * w->steps;
+        int numLanes = w->numRows - r0 < 4 ? w->numRows - r0 : 4;
+        __m128i rowValid = _mm_cmpgt_epi32(_mm_set1_epi32(numLanes), lanes);
+        __m128i row = _mm_add_epi32(_mm_set1_epi32(r0), lanes);
+
+        // Lanes that have not reached the first column of the tile hold the column before it
+        __m128i prev = _mm_loadu_si128((const __m128i*)(w->carry + r0));
+
+        int first, last;
+        gridTileSteps(w, tile, strip, &first, &last);
+        for (int t = first; t < last; t++)
+        {
+            __m128i col = _mm_sub_epi32(_mm_set1_epi32(t), lanes);
+            __m128i started = _mm_cmpgt_epi32(col, _mm_set1_epi32(-1));
+            __m128i valid = _mm_and_si128(rowValid, _mm_and_si128(started, _mm_cmpgt_epi32(numCols, col)));
+
+            // The lanes read diagonally across the strip; away from the edges all four cells are inside the grid
+            __m128i v;
+            if (numLanes == 4 && t >= 3 && t < w->numCols)
+            {
+                v = _mm_setr_epi32(rows[t], rows[stride + t - 1], rows[2 * stride + t - 2], rows[3 * stride + t - 3]);
+            }
+            else
+            {
+                int cells[4] = { 0, 0, 0, 0 };
+                for (int i = 0; i < numLanes; i++)
+                {
+                    if (t - i >= 0 && t - i < w->numCols) cells[i] = rows[i * stride + t - i];
+                }
+                v = _mm_loadu_si128((const __m128i*)cells);
+            }
+
+            __m128i up = _mm_insert_epi32(_mm_slli_si128(prev, 4), t < w->numCols ? upRow[t] : GRID_NO_SUM, 0);
+            __m128i fromLeft = _mm_cmpgt_epi32(prev, up);
+            __m128i cur = _mm_add_epi32(v, _mm_max_epi32(up, prev));
+            cur = _mm_blendv_epi8(_mm_blendv_epi8(prev, none, started), cur, valid);
+            moves[t] = (unsigned char)_mm_movemask_ps(_mm_castsi128_ps(fromLeft));
+            if (t >= 3) upRow[t - 3] = _mm_extract_epi32(cur, 3);
+
+            // Keep the highest cell of each lane, with the same tie rule as offerGridEnd
+            __m128i diagonal = _mm_set1_epi32(r0 + t);
+            __m128i better = _mm_and_si128(valid, _mm_or_si128(_mm_cmpgt_epi32(cur, laneBest),
+                _mm_and_si128(_mm_cmpeq_epi32(cur, laneBest), _mm_cmpgt_epi32(laneDiagonal, diagonal))));
+            laneBest = _mm_blendv_epi8(laneBest, cur, better);
+            laneDiagonal = _mm_blendv_epi8(laneDiagonal, diagonal, better);
+            laneRow = _mm_blendv_epi8(laneRow, row, better);
+            prev = cur;
+        }
+        _mm_storeu_si128((__m128i*)(w->carry + r0), prev);
+    }
+
+    int sums[4], diagonals[4], rowsOf[4];
+    _mm_storeu_si128((__m128i*)sums, laneBest);
+    _mm_storeu_si128((__m128i*)diagonals, laneDiagonal);
+    _mm_storeu_si128((__m128i*)rowsOf, laneRow);
+    for (int i = 0; i < 4; i++)
+    {
+        if (sums[i] != GRID_NO_SUM) offerGridEnd(end, sums[i], diagonals[i], rowsOf[i]);
+    }
+}
+
+/// <summary>
+/// Function to run a tile of the wavefront eight rows at a time with AVX2, like wavefrontSse41
+/// </summary>
+/// <param name="w"></param>
+/// <param name="tile"></param>
+/// <param name="end"></param>
+TARGET_AVX2 static void wavefrontAvx2(const GridWavefront* w, GridTile tile, GridEnd* end)
+{
+    const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const __m256i shift = _mm256_setr_epi32(0, 0, 1, 2, 3, 4, 5, 6);
+    const __m256i none = _mm256_set1_epi32(GRID_NO_SUM);
+    const __m256i numCols = _mm256_set1_epi32(w->numCols);
+    const __m256i minusOne = _mm256_set1_epi32(-1);
+    __m256i laneBest = none, laneDiagonal = _mm256_set1_epi32(INT_MAX), laneRow = _mm256_setzero_si256();
+    int* upRow = w->upRow;
+
+    // Lane i reads rows[i * stride + t - i], which is rows + t plus a fixed offset per lane
+    __m256i offsets = _mm256_mullo_epi32(lanes, _mm256_set1_epi32(w->stride - 1));
+
+    for (int strip = tile.firstStrip; strip < tile.endStrip; strip++)
+    {
+        int r0 = strip * 8;
+        const int* rows = w->values + (size_t)r0 * w->stride;
+        unsigned char* moves = w->moves + (size_t)strip * w->steps;
+        int numLanes = w->numRows - r0 < 8 ? w->numRows - r0 : 8;
+        __m256i rowValid = _mm256_cmpgt_epi32(_mm256_set1_epi32(numLanes), lanes);
+        __m256i row = _mm256_add_epi32(_mm256_set1_epi32(r0), lanes);
+
+        // Lanes that have not reached the first column of the tile hold the column before it
+        __m256i prev = _mm256_loadu_si256((const __m256i*)(w->carry + r0));
+
+        int first, last;
+        gridTileSteps(w, tile, strip, &first, &last);
+        for (int t = first; t < last; t++)
+        {
+            __m256i col = _mm256_sub_epi32(_mm256_set1_epi32(t), lanes);
+            __m256i started = _mm256_cmpgt_epi32(col, minusOne);
+            __m256i valid = _mm256_and_si256(rowValid, _mm256_and_si256(started, _mm256_cmpgt_epi32(numCols, col)));
+
+            // Cells outside the grid are masked out of the gather, so nothing is read for them
+            __m256i v = _mm256_mask_i32gather_epi32(_mm256_setzero_si256(), rows + t, offsets, valid, 4);
+            __m256i up = _mm256_blend_epi32(_mm256_permutevar8x32_epi32(prev, shift),
+                _mm256_set1_epi32(t < w->numCols ? upRow[t] : GRID_NO_SUM), 1);
+            __m256i fromLeft = _mm256_cmpgt_epi32(prev, up);
+            __m256i cur = _mm256_add_epi32(v, _mm256_max_epi32(up, prev));
+            cur = _mm256_blendv_epi8(_mm256_blendv_epi8(prev, none, started), cur, valid);
+            moves[t] = (unsigned char)_mm256_movemask_ps(_mm256_castsi256_ps(fromLeft));
+            if (t >= 7) upRow[t - 7] = _mm256_extract_epi32(cur, 7);
+
+            // Keep the highest cell of each lane, with the same tie rule as offerGridEnd
+            __m256i diagonal = _mm256_set1_epi32(r0 + t);
+            __m256i better = _mm256_and_si256(valid, _mm256_or_si256(_mm256_cmpgt_epi32(cur, laneBest),
+                _mm256_and_si256(_mm256_cmpeq_epi32(cur, laneBest), _mm256_cmpgt_epi32(laneDiagonal, diagonal))));
+            laneBest = _mm256_blendv_epi8(laneBest, cur, better);
+            laneDiagonal = _mm256_blendv_epi8(laneDiagonal, diagonal, better);
+            laneRow = _mm256_blendv_epi8(laneRow, row, better);
+            prev = cur;
+        }
+        _mm256_storeu_si256((__m256i*)(w->carry + r0), prev);
+    }
+
+    int sums[8], diagonals[8], rowsOf[8];
+    _mm256_storeu_si256((__m256i*)sums, laneBest);
+    _mm256_storeu_si256((__m256i*)diagonals, laneDiagonal);
+    _mm256_storeu_si256((__m256i*)rowsOf, laneRow);
+    for (int i = 0; i < 8; i++)
+    {
+        if (sums[i] != GRID_NO_SUM) offerGridEnd(end, sums[i], diagonals[i], rowsOf[i]);
+    }
+}
+#endif
+
+/// <summary>
+/// Function to choose the widest wavefront kernel the processor supports; the check is only done once
+/// </summary>
+/// <returns>Number of rows per strip: 8 for AVX2, 4 for SSE4.1, 1 for the scalar kernel</returns>
+int wavefrontWidth(void)
+{
+    static int width = 0;
+    if (width) return width;
+
+    width = 1;
+#if defined(GRID_SIMD) && defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    int maxLeaf = info[0];
+    __cpuid(info, 1);
+    bool sse41 = (info[2] & (1 << 19)) != 0;
+    bool avx = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6; // The OS saves the AVX registers
+    if (sse41) width = 4;
+    if (avx && maxLeaf >= 7)
+    {
+        __cpuidex(info, 7, 0);
+        if (info[1] & (1 << 5)) width = 8;
+    }
+#elif defined(GRID_SIMD)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse4.1")) width = 4;
+    if (__builtin_cpu_supports("avx2")) width = 8;
+#endif
+    return width;
+}
+
+/// <summary>
+/// Function to run a tile of the wavefront with the kernel chosen for the pass
+/// </summary>
+/// <param name="w"></param>
+/// <param name="tile"></param>
+/// <param name="end"></param>
+static void runGridTile(const GridWavefront* w, GridTile tile, GridEnd* end)
+{
+#ifdef GRID_SIMD
+    if (w->width == 8) wavefrontAvx2(w, tile, end);
+    else if (w->width == 4) wavefrontSse41(w, tile, end);
+    else wavefrontScalar(w, tile, end);
+#else
+    wavefrontScalar(w, tile, end);
+#endif
+}
+
+/// <summary>
+/// Struct to represent the state shared by the workers of a parallel wavefront. Tile (b, j) holds the strips of band b
+/// and the steps of column j; it becomes ready when the tiles it needs are done.
+/// </summary>
+typedef struct
+{
+    GridWavefront* w;
+    int stripsPerBand;
+    int numBands;
+    int numTileCols;
+    AtomicInt* waiting;  // waiting[b * numTileCols + j]: tiles that (b, j) still needs
+    Mutex lock;          // Guards ready, numReady, tilesLeft and end
+    Condition wake;      // Woken when a tile is queued and when the last tile is done
+    int* ready;          // Stack of ready tiles
+    int numReady;
+    long tilesLeft;
+    GridEnd end;
+} GridSchedule;
+
+/// <summary>
+/// Function to mark a tile as needed by one less tile, queueing it and waking an idle worker once nothing is left
+/// </summary>
+/// <param name="s"></param>
+/// <param name="band"></param>
+/// <param name="col"></param>
+static void releaseGridTile(GridSchedule* s, int band, int col)
+{
+    if (band >= s->numBands || col < 0 || col >= s->numTileCols) return;
+
+    int tile = band * s->numTileCols + col;
+    if (atomicAdd(&s->waiting[tile], -1) == 1)
+    {
+        lockMutex(&s->lock);
+        s->ready[s->numReady++] = tile;
+        unlockMutex(&s->lock);
+        wakeOne(&s->wake);
+    }
+}
+
+/// <summary>
+/// Function run by each worker of a parallel wavefront
+/// </summary>
+/// <param name="arg"></param>
+/// <returns></returns>
+static THREAD_FUNCTION gridWorker(void* arg)
+{
+    GridSchedule* s = arg;
+    GridEnd end = { GRID_NO_SUM, INT_MAX, INT_MAX };
+
+    lockMutex(&s->lock);
+    while (true)
+    {
+        // Sleep while the tiles still running hold up the next ones
+        while (s->numReady == 0 && s->tilesLeft > 0)
+        {
+            waitCondition(&s->wake, &s->lock);
+        }
+        if (s->numReady == 0) break;
+        int tile = s->ready[--s->numReady];
+        unlockMutex(&s->lock);
+
+        int band = tile / s->numTileCols, col = tile % s->numTileCols;
+        GridTile t;
+        t.firstStrip = band * s->stripsPerBand;
+        t.endStrip = t.firstStrip + s->stripsPerBand < s->w->numStrips ? t.firstStrip + s->stripsPerBand : s->w->numStrips;
+        t.firstStep = col * GRID_TILE_STEPS;
+        t.endStep = t.firstStep + GRID_TILE_STEPS < s->w->steps ? t.firstStep + GRID_TILE_STEPS : s->w->steps;
+        t.skew = s->w->width - 1;
+        runGridTile(s->w, t, &end);
+
+        // The next tile of the band, and the tiles below that were waiting for this one
+        releaseGridTile(s, band, col + 1);
+        releaseGridTile(s, band + 1, col - 1);
+        if (col == s->numTileCols - 1) releaseGridTile(s, band + 1, col);
+
+        // After the last tile, let the sleeping workers finish
+        lockMutex(&s->lock);
+        if (--s->tilesLeft == 0) wakeAll(&s->wake);
+    }
+
+    offerGridEnd(&s->end, end.best, end.diagonal, end.row);
+    unlockMutex(&s->lock);
+    return THREAD_RETURN;
+}
+
+/// <summary>
+/// Function to run a whole wavefront pass, split in tiles over several threads
+/// </summary>
+/// <param name="w"></param>
+/// <param name="numThreads"></param>
+/// <param name="end"></param>
+static void runGridTiles(GridWavefront* w, int numThreads, GridEnd* end)
+{
+    GridSchedule s;
+    s.w = w;
+    s.stripsPerBand = GRID_TILE_ROWS / w->width;
+    s.numBands = (w->numStrips + s.stripsPerBand - 1) / s.stripsPerBand;
+    s.numTileCols = (w->steps + GRID_TILE_STEPS - 1) / GRID_TILE_STEPS;
+    s.tilesLeft = (long)s.numBands * s.numTileCols;
+    s.numReady = 0;
+    s.end = *end;
+    s.waiting = malloc(s.tilesLeft * sizeof(AtomicInt));
+    s.ready = malloc(s.tilesLeft * sizeof(int));
+    Thread* threads = malloc(numThreads * sizeof(Thread));
+
+    // Check if memory allocation was successful
+    if (!s.waiting || !s.ready || !threads)
+    {
+        perror("Failed to allocate memory for grid tiles");
+        exit(EXIT_FAILURE);
+    }
+    initMutex(&s.lock);
+    initCondition(&s.wake);
+
+    // A tile waits for the one before it and the one above and to the right, or the one above in the last column
+    for (int b = 0; b < s.numBands; b++)
+    {
+        for (int j = 0; j < s.numTileCols; j++)
+        {
+            s.waiting[b * s.numTileCols + j] = (j > 0) + (b > 0);
+        }
+    }
+    s.ready[s.numReady++] = 0;
+
+    // The calling thread works too; if a thread cannot be started, the others take its tiles
+    int started = 1;
+    while (started < numThreads && startThread(&threads[started], gridWorker, &s))
+    {
+        started++;
+    }
+    gridWorker(&s);
+    for (int i = 1; i < started; i++)
+    {
+        joinThread(threads[i]);
+    }
+    *end = s.end;
+
+    destroyCondition(&s.wake);
+    destroyMutex(&s.lock);
+    free((void*)s.waiting);
+    free(s.ready);
+    free(threads);
+}
+
+/// <summary>
+/// Function to find the highest sum path of a grid loaded from a matrix, where each cell leads to its right and bottom
+/// neighbours, with the wavefront split in tiles over several threads. A wavefront kernel computes the best sum of
+/// every cell, keeping one bit per cell, then the path is rebuilt from the bits; the result is the same path
+/// cachedHighestSum finds.
+/// </summary>
+/// <param name="g"></param>
+/// <param name="startVertex"></param>
+/// <param name="maxSum"></param>
+/// <param name="bestPath"></param>
+/// <param name="bestPathLen"></param>
+/// <param name="numThreads">Number of threads to use, or 0 to use one per processor</param>
+/// <returns>true if the path was computed, false if the graph is not such a grid</returns>
+bool gridHighestSumParallel(Graph* g, int startVertex, int* maxSum, int bestPath[], int* bestPathLen, int numThreads)
+{
+    if (g->storage != STORAGE_GRID || g->stencil != STENCIL_RIGHT_DOWN || !vertexExists(g, startVertex))
+    {
+        return false;
+    }
+    if (numThreads <= 0) numThreads = cpuCount();
+    statsSearchStarted(searchStats, numThreads > 1 ? "grid-wavefront-parallel" : "grid-wavefront");
+
+    // Only the cells below and to the right of the start vertex can be reached
+    int startRow = startVertex / g->numCols, startCol = startVertex % g->numCols;
+    GridWavefront w;
+    w.values = g->values + startVertex;
+    w.stride = g->numCols;
+    w.numRows = g->numRows - startRow;
+    w.numCols = g->numCols - startCol;
+    w.width = wavefrontWidth();
+    w.numStrips = (w.numRows + w.width - 1) / w.width;
+    w.steps = w.numCols + w.width - 1;
+    w.moves = malloc((size_t)w.numStrips * w.steps);
+    w.upRow = malloc(w.numCols * sizeof(int));
+    w.carry = malloc((size_t)w.numStrips * w.width * sizeof(int));
+
+    // Check if memory allocation was successful
+    if (!w.moves || !w.upRow || !w.carry)
+    {
+        perror("Failed to allocate memory for grid wavefront");
+        exit(EXIT_FAILURE);
+    }
+
+    // Only the start cell has a way in from above, and no cell has one from the left of the first column
+    w.upRow[0] = 0;
+    for (int c = 1; c < w.numCols; c++)
+    {
+        w.upRow[c] = GRID_NO_SUM;
+    }
+    for (int i = 0; i < w.numStrips * w.width; i++)
+    {
+        w.carry[i] = GRID_NO_SUM;
+    }
+
+    GridEnd end = { GRID_NO_SUM, INT_MAX, INT_MAX };
+    if (numThreads > 1)
+    {
+        runGridTiles(&w, numThreads, &end);
+    }
+    else
+    {
+        GridTile all = { 0, w.numStrips, 0, w.steps, 0 };
+        runGridTile(&w, all, &end);
+    }
+    free(w.upRow);
+    free(w.carry);
+    if (searchStats) searchStats->expanded += (long long)w.numRows * w.numCols;
+
+    // Same rule as the backtracking search: a path only counts if its sum is above zero
+    *maxSum = 0;
+    *bestPathLen = 0;
+    if (end.best > 0)
+    {
+        // Walk back from the end cell to the start cell
+        *maxSum = end.best;
+        *bestPathLen = end.diagonal + 1;
+        for (int r = end.row, c = end.diagonal - end.row, i = *bestPathLen - 1; i >= 0; i--)
+        {
+            bestPath[i] = (startRow + r) * g->numCols + startCol + c;
+            int lane = r % w.width;
+            if ((w.moves[(size_t)(r / w.width) * w.steps + c + lane] >> lane) & 1) c--;
+            else r--;
+        }
+
+        if (searchStats && *bestPathLen > searchStats->maxDepth) searchStats->maxDepth = *bestPathLen;
+        statsPathCompleted(searchStats);
+        statsImprovement(searchStats, *maxSum);
+    }
+
+    free(w.moves);
+    return true;
+}
+
+/// <summary>
+/// Function to find the highest sum path of a grid loaded from a matrix on the calling thread, see gridHighestSumParallel
+/// </summary>
+/// <param name="g"></param>
+/// <param name="startVertex"></param>
+/// <param name="maxSum"></param>
+/// <param name="bestPath"></param>
+/// <param name="bestPathLen"></param>
+/// <returns>true if the path was computed, false if the graph is not such a grid</returns>
+bool gridHighestSum(Graph* g, int startVertex, int* maxSum, int bestPath[], int* bestPathLen)
+{
+    return gridHighestSumParallel(g, startVertex, maxSum, bestPath, bestPathLen, 1);
+}
+#pragma endregion
+
+#pragma region Streaming Highest Sum
+// Size of the blocks a matrix file is read in by streamHighestSum
+#define STREAM_BUFFER_SIZE (1 << 20)
+
+/// <summary>
+/// Struct to represent a cell of a matrix by its row and column, for matrices too large to number their cells with an int
+/// </summary>
+typedef struct
+{
+    int row;
+    int col;
+} GridCell;
+
+/// <summary>
+/// Struct to read a matrix file one row at a time through a fixed size buffer
+/// </summary>
+typedef struct
+{
+    FILE* file;
+    const char* filename;
+    char* buffer;
+    size_t pos;
+    size_t len;
+    int* row;         // Values of the last row read
+    int capacity;
+    int numRows;      // Rows read so far
+} MatrixStream;
+
+/// <summary>
+/// Function to get the next character of a matrix file
+/// </summary>
+/// <param name="s"></param>
+/// <returns>The character, or EOF at the end of the file</returns>
+static inline int streamChar(MatrixStream* s)
+{
+    if (s->pos == s->len)
+    {
+        s->len = fread(s->buffer, 1, STREAM_BUFFER_SIZE, s->file);
+        s->pos = 0;
+        if (s->len == 0) return EOF;
+    }
+    return (unsigned char)s->buffer[s->pos++];
+}
+
+/// <summary>
+/// Function to read the next row of a matrix file, in the format of readMatrixFile; empty lines are skipped
+/// </summary>
+/// <param name="s"></param>
+/// <returns>Number of values in the row, 0 at the end of the file</returns>
+static int readStreamRow(MatrixStream* s)
+{
+    int col = 0;
+    int c = streamChar(s);
+    while (c != EOF)
+    {
+        // End of a line: close the row unless it is empty
+        if (c == '\n')
+        {
+            if (col > 0) break;
+            c = streamChar(s);
+            continue;
+        }
+
+        // Skip separators and blanks
+        if (c == ';' || c == ' ' || c == '\t' || c == '\r')
+        {
+            c = streamChar(s);
+            continue;
+        }
+
+        // Parse an integer
+        bool negative = false;
+        if (c == '-' || c == '+')
+        {
+            negative = c == '-';
+            c = streamChar(s);
+        }
+        if (c < '0' || c > '9')
+        {
+            fprintf(stderr, "Invalid value in row %d of %s\n", s->numRows + 1, s->filename);
+            exit(EXIT_FAILURE);
+        }
+        unsigned int value = 0;
+        while (c >= '0' && c <= '9')
+        {
+            value = value * 10 + (unsigned int)(c - '0');
+            c = streamChar(s);
+        }
+
+        // Only the first row can grow the array, the others must have its width
+        if (col == s->capacity)
+        {
+            s->capacity *= 2;
+            int* temp = realloc(s->row, s->capacity * sizeof(int));
+            if (!temp)
+            {
+                perror("Failed to reallocate memory for matrix values");
+                exit(EXIT_FAILURE);
+            }
+            s->row = temp;
+        }
+        s->row[col++] = negative ? -(int)value : (int)value;
+    }
+
+    if (col > 0) s->numRows++;
+    return col;
+}
+
+/// <summary>
+/// Function to move to a position of a file that may be beyond what a long can hold
+/// </summary>
+/// <param name="file"></param>
+/// <param name="offset"></param>
+/// <returns>true if successful, false otherwise</returns>
+static bool seekFile(FILE* file, long long offset)
+{
+#ifdef _WIN32
+    return _fseeki64(file, offset, SEEK_SET) == 0;
+#else
+    return fseeko(file, (off_t)offset, SEEK_SET) == 0;
+#endif
+}
+
+/// <summary>
+/// Function to find the highest sum path of a matrix file where each cell leads to its right and bottom neighbours,
+/// without loading the matrix. The file is read one row at a time: the best sums of a row only need the row above,
+/// so only one row of sums is kept, and the direction each cell was reached from is written to a temporary file,
+/// one bit per cell, to walk the path back at the end. The result is the path loadMatrixAsGrid and dfs find.
+/// </summary>
+/// <param name="filename"></param>
+/// <param name="start">Cell the paths start from</param>
+/// <param name="maxSum"></param>
+/// <param name="bestPathLen"></param>
+/// <param name="numCols">Width of the matrix, to turn the cells into vertex indices when they fit in an int</param>
+/// <returns>Cells of the best path, to be freed by the caller, or NULL if there is no path with a sum above zero</returns>
+GridCell* streamHighestSum(const char* filename, GridCell start, int* maxSum, int* bestPathLen, int* numCols)
+{
+    MatrixStream s = { 0 };
+    s.filename = filename;
+    s.file = fopen(filename, "rb");
+    if (!s.file)
+    {
+        perror("File not found");
+        exit(EXIT_FAILURE);
+    }
+    s.capacity = 1024;
+    s.buffer = malloc(STREAM_BUFFER_SIZE);
+    s.row = malloc(s.capacity * sizeof(int));
+
+    // Check if memory allocation was successful
+    if (!s.buffer || !s.row)
+    {
+        perror("Failed to allocate memory for matrix stream");
+        exit(EXIT_FAILURE);
+    }
+    statsSearchStarted(searchStats, "stream");
+
+    *maxSum = 0;
+    *bestPathLen = 0;
+    *numCols = readStreamRow(&s);
+    if (start.row < 0 || start.col < 0 || start.col >= *numCols)
+    {
+        printf("Invalid vertex index.\n");
+        fclose(s.file);
+        free(s.buffer);
+        free(s.row);
+        return NULL;
+    }
+
+    // Only the columns from the start one on can be reached
+    int width = *numCols - start.col;
+    size_t rowBytes = ((size_t)width + 7) / 8;
+    int* best = malloc(width * sizeof(int));
+    unsigned char* moves = calloc(rowBytes, 1);
+    FILE* spill = tmpfile();
+    if (!best || !moves)
+    {
+        perror("Failed to allocate memory for matrix stream");
+        exit(EXIT_FAILURE);
+    }
+    if (!spill)
+    {
+        perror("Failed to create temporary file");
+        exit(EXIT_FAILURE);
+    }
+
+    // Only the start cell has a way in from above
+    best[0] = 0;
+    for (int c = 1; c < width; c++)
+    {
+        best[c] = GRID_NO_SUM;
+    }
+
+    GridEnd end = { GRID_NO_SUM, INT_MAX, INT_MAX };
+    for (int cols = *numCols; cols > 0; cols = readStreamRow(&s))
+    {
+        if (cols != *numCols)
+        {
+            fprintf(stderr, "Row %d of %s has %d values, expected %d\n", s.numRows, filename, cols, *numCols);
+            exit(EXIT_FAILURE);
+        }
+        int r = s.numRows - 1 - start.row;
+        if (r < 0) continue;
+
+        // best[c] still holds the cell above while left is the cell just computed
+        const int* values = s.row + start.col;
+        int left = GRID_NO_SUM;
+        memset(moves, 0, rowBytes);
+        for (int c = 0; c < width; c++)
+        {
+            int up = best[c];
+            if (left > up) moves[c >> 3] |= (unsigned char)(1 << (c & 7));
+            left = values[c] + (left > up ? left : up);
+            best[c] = left;
+            offerGridEnd(&end, left, r + c, r);
+        }
+        if (fwrite(moves, 1, rowBytes, spill) != rowBytes)
+        {
+            perror("Failed to write temporary file");
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (s.numRows <= start.row) printf("Invalid vertex index.\n");
+    else if (searchStats) searchStats->expanded += (long long)(s.numRows - start.row) * width;
+    fclose(s.file);
+    free(s.buffer);
+    free(s.row);
+    free(best);
+
+    // Same rule as the backtracking search: a path only counts if its sum is above zero
+    GridCell* path = NULL;
+    if (end.best > 0)
+    {
+        *maxSum = end.best;
+        *bestPathLen = end.diagonal + 1;
+        path = malloc(*bestPathLen * sizeof(GridCell));
+        if (!path)
+        {
+            perror("Failed to allocate memory for best path");
+            exit(EXIT_FAILURE);
+        }
+
+        // Walk back from the end cell, reading the bits of each row once
+        int loaded = -1;
+        for (int r = end.row, c = end.diagonal - end.row, i = *bestPathLen - 1; i >= 0; i--)
+        {
+            path[i].row = start.row + r;
+            path[i].col = start.col + c;
+            if (r != loaded)
+            {
+                if (!seekFile(spill, (long long)r * rowBytes) || fread(moves, 1, rowBytes, spill) != rowBytes)
+                {
+                    perror("Failed to read temporary file");
+                    exit(EXIT_FAILURE);
+                }
+                loaded = r;
+            }
+            if ((moves[c >> 3] >> (c & 7)) & 1) c--;
+            else r--;
+        }
+
+        if (searchStats && *bestPathLen > searchStats->maxDepth) searchStats->maxDepth = *bestPathLen;
+        statsPathCompleted(searchStats);
+        statsImprovement(searchStats, *maxSum);
+    }
+
+    fclose(spill);
+    free(moves);
+    return path;
+}
+#pragma endregion
+
+#pragma region Path Statistics
+// Histograms are only computed while the sum distributions in memory stay under this number of entries
+#define HISTOGRAM_MEMORY_LIMIT (1 << 26)
+
+/// <summary>
+/// Struct to represent a 128-bit path count
+/// </summary>
+typedef struct
+{
+    uint64_t low;
+    uint64_t high;
+} PathCount;
+
+/// <summary>
+/// Struct to represent the statistics of all the paths between two vertices
+/// </summary>
+typedef struct
+{
+    PathCount count;
+    bool overflow;   // The count did not fit in 128 bits and was saturated
+    int minSum;
+    int maxSum;
+    double meanSum;
+    bool histogram;  // The histogram was filled in (it is skipped when the sum distributions would use too much memory)
+} PathStats;
+
+/// <summary>
+/// Function to add a path count to another one, saturating on overflow
+/// </summary>
+/// <param name="a"></param>
+/// <param name="b"></param>
+/// <returns>false if the result overflowed</returns>
+static bool addPathCount(PathCount* a, PathCount b)
+{
+    uint64_t low = a->low + b.low;
+    uint64_t carry = low < a->low;
+    uint64_t high = a->high + b.high + carry;
+    if (high < a->high || (high == a->high && (b.high | carry) != 0))
+    {
+        a->low = UINT64_MAX;
+        a->high = UINT64_MAX;
+        return false;
+    }
+    a->low = low;
+    a->high = high;
+    return true;
+}
+
+/// <summary>
+/// Function to write a path count in decimal
+/// </summary>
+/// <param name="c"></param>
+/// <param name="buffer">At least 40 characters</param>
+void formatPathCount(PathCount c, char buffer[])
+{
+    // Divide by 10 one 32-bit word at a time, most significant first
+    uint32_t words[4] = { (uint32_t)(c.high >> 32), (uint32_t)c.high, (uint32_t)(c.low >> 32), (uint32_t)c.low };
+    char digits[40];
+    int numDigits = 0;
+
+    do
+    {
+        uint64_t remainder = 0;
+        for (int i = 0; i < 4; i++)
+        {
+            uint64_t current = (remainder << 32) | words[i];
+            words[i] = (uint32_t)(current / 10);
+            remainder = current % 10;
+        }
+        digits[numDigits++] = (char)('0' + remainder);
+    } while (words[0] | words[1] | words[2] | words[3]);
+
+    for (int i = 0; i < numDigits; i++)
+    {
+        buffer[i] = digits[numDigits - 1 - i];
+    }
+    buffer[numDigits] = '\0';
+}
+
+/// <summary>
+/// Function to mark the vertices of a topological order that can reach the destination vertex
+/// </summary>
+/// <param name="g"></param>
+/// <param name="order"></param>
+/// <param name="orderLen"></param>
+/// <param name="dst"></param>
+/// <param name="canReach"></param>
+static void markCanReach(Graph* g, const int order[], int orderLen, int dst, char canReach[])
+{
+    // Successors come later in the order, so a reverse pass sees them first
+    for (int i = orderLen - 1; i >= 0; i--)
+    {
+        int v = order[i];
+        canReach[v] = v == dst;
+        int numAdj = vertexDegree(g, v);
+        for (int j = 0; j < numAdj && !canReach[v]; j++)
+        {
+            canReach[v] = canReach[vertexAdjacent(g, v, j)];
+        }
+    }
+}
+
+/// <summary>
+/// Function to fill a histogram of the path sums at the destination by propagating the exact distribution of sums
+/// to every vertex in topological order. A vertex's distribution is released once it has been pushed to its successors.
+/// </summary>
+/// <returns>false if the distributions would need more than HISTOGRAM_MEMORY_LIMIT entries</returns>
+static bool sumHistogram(Graph* g, const int order[], int orderLen, int src, int dst, const char canReach[],
+    const int minSums[], const int maxSums[], double histogram[], int numBuckets)
+{
+    double** dist = calloc(g->numVertices, sizeof(double*));
+    if (!dist)
+    {
+        perror("Failed to allocate memory for path histogram");
+        exit(EXIT_FAILURE);
+    }
+
+    long long live = 1;
+    bool ok = true;
+    dist[src] = calloc(1, sizeof(double));
+    if (!dist[src])
+    {
+        perror("Failed to allocate memory for path histogram");
+        exit(EXIT_FAILURE);
+    }
+    dist[src][0] = 1;
+
+    for (int i = 0; i < orderLen && ok; i++)
+    {
+        int v = order[i];
+        if (!dist[v] || v == dst) continue;
+
+        int numAdj = vertexDegree(g, v);
+        int range = maxSums[v] - minSums[v] + 1;
+        for (int j = 0; j < numAdj && ok; j++)
+        {
+            int adj = vertexAdjacent(g, v, j);
+            if (!canReach[adj]) continue;
+
+            int adjRange = maxSums[adj] - minSums[adj] + 1;
+            if (!dist[adj])
+            {
+                live += adjRange;
+                if (live > HISTOGRAM_MEMORY_LIMIT)
+                {
+                    ok = false;
+                    break;
+                }
+                dist[adj] = calloc(adjRange, sizeof(double));
+                if (!dist[adj])
+                {
+                    perror("Failed to allocate memory for path histogram");
+                    exit(EXIT_FAILURE);
+                }
+            }
+
+            // Every path to v extended by adj has its sum shifted by the value of adj
+            double* target = dist[adj] + (minSums[v] + vertexValue(g, adj) - minSums[adj]);
+            for (int k = 0; k < range; k++)
+            {
+                target[k] += dist[v][k];
+            }
+        }
+
+        free(dist[v]);
+        dist[v] = NULL;
+        live -= range;
+    }
+
+    // Group the sums of the destination into buckets of equal width
+    if (ok && dist[dst])
+    {
+        int range = maxSums[dst] - minSums[dst] + 1;
+        int width = (range + numBuckets - 1) / numBuckets;
+        memset(histogram, 0, numBuckets * sizeof(double));
+        for (int k = 0; k < range; k++)
+        {
+            histogram[k / width] += dist[dst][k];
+        }
+    }
+
+    for (int v = 0; v < g->numVertices; v++)
+    {
+        free(dist[v]);
+    }
+    free(dist);
+    return ok;
+}
+
+/// <summary>
+/// Function to compute, in an acyclic graph, the number of paths from a source to a destination vertex and the
+/// minimum, maximum and mean of their sums, without listing the paths
+/// </summary>
+/// <param name="g"></param>
+/// <param name="src"></param>
+/// <param name="dst"></param>
+/// <param name="stats"></param>
+/// <param name="histogram">Optional: numBuckets path counts by sum, bucket i starting at minSum + i * ceil((maxSum - minSum + 1) / numBuckets)</param>
+/// <param name="numBuckets"></param>
+/// <returns>false if a cycle is reachable from the source, in which case no statistics are computed</returns>
+bool pathStatistics(Graph* g, int src, int dst, PathStats* stats, double histogram[], int numBuckets)
+{
+    memset(stats, 0, sizeof(PathStats));
+    if (histogram && numBuckets > 0)
+    {
+        memset(histogram, 0, numBuckets * sizeof(double));
+    }
+
+    int* order = malloc(g->numVertices * sizeof(int));
+    int orderLen = 0;
+
+    // Check if memory allocation was successful
+    if (!order)
+    {
+        perror("Failed to allocate memory for path statistics");
+        exit(EXIT_FAILURE);
+    }
+
+    double start = statsPhaseBegin();
+    statsSearchStarted(searchStats, "path-statistics");
+    if (!topologicalSort(g, src, order, &orderLen))
+    {
+        statsPhaseEnd(PHASE_SEARCH, start);
+        free(order);
+        return false;
+    }
+
+    char* canReach = calloc(g->numVertices, sizeof(char));
+    char* seen = calloc(g->numVertices, sizeof(char));
+    PathCount* counts = calloc(g->numVertices, sizeof(PathCount));
+    double* weights = calloc(g->numVertices, sizeof(double));
+    double* totals = calloc(g->numVertices, sizeof(double));
+    int* minSums = malloc(g->numVertices * sizeof(int));
+    int* maxSums = malloc(g->numVertices * sizeof(int));
+
+    // Check if memory allocation was successful
+    if (!canReach || !seen || !counts || !weights || !totals || !minSums || !maxSums)
+    {
+        perror("Failed to allocate memory for path statistics");
+        exit(EXIT_FAILURE);
+    }
+
+    // Only the vertices between the source and the destination matter
+    markCanReach(g, order, orderLen, dst, canReach);
+
+    if (canReach[src])
+    {
+        // counts[v] paths lead from the source to v, their sums add up to totals[v] and lie in minSums[v] .. maxSums[v].
+        // weights[v] is the same count as a double, which keeps the mean right when the exact count overflows.
+        seen[src] = 1;
+        counts[src].low = 1;
+        weights[src] = 1;
+        totals[src] = minSums[src] = maxSums[src] = vertexValue(g, src);
+
+        for (int i = 0; i < orderLen; i++)
+        {
+            int v = order[i];
+            if (!seen[v] || v == dst) continue;
+            statsExpand(searchStats, 0);
+
+            int numAdj = vertexDegree(g, v);
+            for (int j = 0; j < numAdj; j++)
+            {
+                int adj = vertexAdjacent(g, v, j);
+                if (!canReach[adj]) continue;
+
+                int value = vertexValue(g, adj);
+                if (!seen[adj])
+                {
+                    seen[adj] = 1;
+                    minSums[adj] = minSums[v] + value;
+                    maxSums[adj] = maxSums[v] + value;
+                }
+                else
+                {
+                    if (minSums[v] + value < minSums[adj]) minSums[adj] = minSums[v] + value;
+                    if (maxSums[v] + value > maxSums[adj]) maxSums[adj] = maxSums[v] + value;
+                }
+
+                if (!addPathCount(&counts[adj], counts[v])) stats->overflow = true;
+                weights[adj] += weights[v];
+                totals[adj] += totals[v] + weights[v] * value;
+            }
+        }
+
+        stats->count = counts[dst];
+        stats->minSum = minSums[dst];
+        stats->maxSum = maxSums[dst];
+        stats->meanSum = totals[dst] / weights[dst];
+
+        if (histogram && numBuckets > 0)
+        {
+            stats->histogram = sumHistogram(g, order, orderLen, src, dst, canReach, minSums, maxSums, histogram, numBuckets);
+        }
+    }
+    statsPhaseEnd(PHASE_SEARCH, start);
+
+    free(order);
+    free(canReach);
+    free(seen);
+    free(counts);
+    free(weights);
+    free(totals);
+    free(minSums);
+    free(maxSums);
+    return true;
+}
+
+/// <summary>
+/// Function to count the paths from a source to a destination vertex in an acyclic graph, in O(V+E)
+/// </summary>
+/// <param name="g"></param>
+/// <param name="src"></param>
+/// <param name="dst"></param>
+/// <param name="count"></param>
+/// <returns>false if a cycle is reachable from the source, in which case nothing is counted</returns>
+bool countPaths(Graph* g, int src, int dst, PathCount* count)
+{
+    PathStats stats;
+    bool acyclic = pathStatistics(g, src, dst, &stats, NULL, 0);
+    *count = stats.count;
+    return acyclic;
+}
+#pragma endregion
+
+#pragma region Parallel DFS
+/// <summary>
+/// Struct to represent a subtree of the search, given by the path from the start vertex to its root
+/// </summary>
+typedef struct
+{
+    int prefix; // Position of the path in the prefix pool
+    int length;
+    int sum;    // Sum of the values on the path
+    int order;  // Position of the subtree in the order the sequential search would visit it
+} SearchTask;
+
+/// <summary>
+/// Struct to represent the queue of tasks of a worker. The owner takes from the head, other workers steal from the tail.
+/// </summary>
+typedef struct
+{
+    Mutex lock;
+    int head;
+    int tail;
+} TaskDeque;
+
+/// <summary>
+/// Struct to represent the state shared by all the workers of a parallel search
+/// </summary>
+typedef struct
+{
+    Graph* g;
+    SearchTask* tasks;
+    int numTasks;
+    int taskCapacity;
+    int* prefixes;
+    int prefixesLen;
+    int prefixesCapacity;
+    int nextOrder;
+    TaskDeque* deques; // deques[w] holds the task indexes head .. tail - 1
+    int numWorkers;
+
+    // Best path so far; maxSum can be read without the lock to discard losing paths
+    AtomicInt maxSum;
+    Mutex bestLock;
+    int bestOrder;
+    int* bestPath;
+    int bestPathLen;
+} ParallelSearch;
+
+/// <summary>
+/// Struct to represent a worker thread with its own search buffers
+/// </summary>
+typedef struct
+{
+    ParallelSearch* search;
+    int index;
+    uint64_t* visited;
+    int* path;
+    SearchFrame* frames;
+    int order; // Order of the task being searched
+    SearchStats stats;
+    SearchStats* counters; // The worker's own statistics, or NULL when they are off
+    Thread thread;
+} SearchWorker;
+
+/// <summary>
+/// Function to offer a path as the new best path. Ties go to the path the sequential search would have found first.
+/// </summary>
+/// <param name="s"></param>
+/// <param name="path"></param>
+/// <param name="pathLen"></param>
+/// <param name="sum"></param>
+/// <param name="order"></param>
+static void offerBestPath(ParallelSearch* s, const int path[], int pathLen, int sum, int order)
+{
+    // Most paths lose against the current best, which is checked without taking the lock
+    if (sum < atomicLoad(&s->maxSum)) return;
+
+    lockMutex(&s->bestLock);
+    long maxSum = atomicLoad(&s->maxSum);
+    if (sum > maxSum || (sum == maxSum && s->bestPathLen > 0 && order < s->bestOrder))
+    {
+        memcpy(s->bestPath, path, pathLen * sizeof(int));
+        s->bestPathLen = pathLen;
+        s->bestOrder = order;
+        if (sum > maxSum) statsImprovement(searchStats, sum);
+        atomicStore(&s->maxSum, sum);
+    }
+    unlockMutex(&s->bestLock);
+}
+
+/// <summary>
+/// Function to count the subtrees found at a given depth of the search, stopping once the limit is reached
+/// </summary>
+/// <param name="g"></param>
+/// <param name="v"></param>
+/// <param name="visited"></param>
+/// <param name="depth"></param>
+/// <param name="limit"></param>
+/// <returns></returns>
+static int countSearchTasks(Graph* g, int v, uint64_t visited[], int depth, int limit)
+{
+    if (depth == 0) return 1;
+
+    int count = 0;
+    markVisited(visited, v);
+    int numAdj = vertexDegree(g, v);
+    for (int i = 0; i < numAdj && count < limit; i++)
+    {
+        int adj = vertexAdjacent(g, v, i);
+        if (!isVisited(visited, adj))
+        {
+            count += countSearchTasks(g, adj, visited, depth - 1, limit - count);
+        }
+    }
+    clearVisited(visited, v);
+    return count;
+}
+
+/// <summary>
+/// Function to split the search into the subtrees found at a given depth, in the order the sequential search visits them.
+/// The shorter paths on the way are offered as candidates directly.
+/// </summary>
+/// <param name="s"></param>
+/// <param name="visited"></param>
+/// <param name="path"></param>
+/// <param name="pathLen"></param>
+/// <param name="sum"></param>
+/// <param name="depth"></param>
+static void splitSearch(ParallelSearch* s, uint64_t visited[], int path[], int pathLen, int sum, int depth)
+{
+    Graph* g = s->g;
+    int v = path[pathLen - 1];
+
+    // Deep enough: the rest of this subtree becomes a task
+    if (depth == 0)
+    {
+        if (s->numTasks == s->taskCapacity || s->prefixesLen + pathLen > s->prefixesCapacity)
+        {
+            s->taskCapacity *= 2;
+            s->prefixesCapacity = s->prefixesCapacity * 2 + pathLen;
+            SearchTask* tasks = realloc(s->tasks, s->taskCapacity * sizeof(SearchTask));
+            int* prefixes = realloc(s->prefixes, s->prefixesCapacity * sizeof(int));
+            if (!tasks || !prefixes)
+            {
+                perror("Failed to reallocate memory for search tasks");
+                exit(EXIT_FAILURE);
+            }
+            s->tasks = tasks;
+            s->prefixes = prefixes;
+        }
+
+        SearchTask* task = &s->tasks[s->numTasks++];
+        task->prefix = s->prefixesLen;
+        task->length = pathLen;
+        task->sum = sum;
+        task->order = s->nextOrder++;
+        memcpy(s->prefixes + s->prefixesLen, path, pathLen * sizeof(int));
+        s->prefixesLen += pathLen;
+        return;
+    }
+
+    // This path is not searched by any task
+    statsExpand(searchStats, pathLen);
+    offerBestPath(s, path, pathLen, sum, s->nextOrder++);
+
+    markVisited(visited, v);
+    int numAdj = vertexDegree(g, v);
+    for (int i = 0; i < numAdj; i++)
+    {
+        int adj = vertexAdjacent(g, v, i);
+        if (!isVisited(visited, adj))
+        {
+            path[pathLen] = adj;
+            splitSearch(s, visited, path, pathLen + 1, sum + vertexValue(g, adj), depth - 1);
+        }
+    }
+    clearVisited(visited, v);
+}
+
+/// <summary>
+/// Function to backtrack through a subtree of a parallel search, like dfsBacktraking
+/// </summary>
+/// <param name="w"></param>
+/// <param name="v"></param>
+/// <param name="pathLen"></param>
+/// <param name="currentSum"></param>
+static void parallelBacktracking(SearchWorker* w, int v, int pathLen, int currentSum)
+{
+    Graph* g = w->search->g;
+    SearchFrame* frames = w->frames;
+    int depth = 0;
+
+    while (v >= 0 || depth > 0)
+    {
+        if (v >= 0)
+        {
+            // Mark the vertex as visited and add it to the path
+            markVisited(w->visited, v);
+            w->path[pathLen++] = v;
+            currentSum += vertexValue(g, v);
+            statsExpand(w->counters, pathLen);
+
+            offerBestPath(w->search, w->path, pathLen, currentSum, w->order);
+
+            frames[depth++] = (SearchFrame){ v, 0, vertexDegree(g, v), currentSum, false };
+            v = -1;
+            continue;
+        }
+
+        // Visit the next unvisited adjacent vertex of the last vertex on the path
+        SearchFrame* f = &frames[depth - 1];
+        while (f->next < f->numAdj)
+        {
+            int adj = vertexAdjacent(g, f->vertex, f->next++);
+            if (!isVisited(w->visited, adj))
+            {
+                v = adj;
+                break;
+            }
+            statsBacktrack(w->counters, 1);
+        }
+        if (v >= 0)
+        {
+            f->extended = true;
+            currentSum = f->sum;
+            continue;
+        }
+
+        // Backtrack
+        if (!f->extended) statsPathCompleted(w->counters);
+        clearVisited(w->visited, f->vertex);
+        pathLen--;
+        depth--;
+        currentSum = depth > 0 ? frames[depth - 1].sum : 0;
+    }
+}
+
+/// <summary>
+/// Function to take the next task of a worker, stealing from the other workers when its own queue is empty
+/// </summary>
+/// <param name="w"></param>
+/// <returns>The task index, or -1 when no task is left</returns>
+static int takeSearchTask(SearchWorker* w)
+{
+    ParallelSearch* s = w->search;
+
+    for (int k = 0; k < s->numWorkers; k++)
+    {
+        TaskDeque* d = &s->deques[(w->index + k) % s->numWorkers];
+        int task = -1;
+
+        lockMutex(&d->lock);
+        if (d->head < d->tail)
+        {
+            // Take the next task of our own queue, or the last task of another one
+            task = k == 0 ? d->head++ : --d->tail;
+        }
+        unlockMutex(&d->lock);
+
+        if (task >= 0) return task;
+    }
+    return -1;
+}
+
+/// <summary>
+/// Function run by each worker of a parallel search
+/// </summary>
+/// <param name="arg"></param>
+/// <returns></returns>
+static THREAD_FUNCTION searchWorker(void* arg)
+{
+    SearchWorker* w = arg;
+    ParallelSearch* s = w->search;
+    int t;
+
+    while ((t = takeSearchTask(w)) >= 0)
+    {
+        SearchTask* task = &s->tasks[t];
+        int* prefix = s->prefixes + task->prefix;
+        int root = prefix[task->length - 1];
+
+        // Restore the path leading to the root of the subtree
+        for (int i = 0; i < task->length - 1; i++)
+        {
+            markVisited(w->visited, prefix[i]);
+            w->path[i] = prefix[i];
+        }
+        w->order = task->order;
+        parallelBacktracking(w, root, task->length - 1, task->sum - vertexValue(s->g, root));
+
+        for (int i = 0; i < task->length - 1; i++)
+        {
+            clearVisited(w->visited, prefix[i]);
+        }
+    }
+    return THREAD_RETURN;
+}
+
+/// <summary>
+/// Function to find the highest sum path with a backtracking search split over several threads.
+/// The result is the same path the sequential dfsBacktraking search finds.
+/// </summary>
+/// <param name="g"></param>
+/// <param name="startVertex"></param>
+/// <param name="maxSum"></param>
+/// <param name="bestPath"></param>
+/// <param name="bestPathLen"></param>
+/// <param name="numThreads">Number of threads to use, or 0 to use one per processor</param>
+void dfsParallel(Graph* g, int startVertex, int* maxSum, int bestPath[], int* bestPathLen, int numThreads)
+{
+    if (numThreads <= 0) numThreads = cpuCount();
+    statsSearchStarted(searchStats, "parallel");
+
+    ParallelSearch s;
+    s.g = g;
+    s.numTasks = 0;
+    s.taskCapacity = 64;
+    s.prefixesLen = 0;
+    s.prefixesCapacity = 256;
+    s.nextOrder = 0;
+    s.numWorkers = numThreads;
+    s.maxSum = 0;
+    s.bestOrder = 0;
+    s.bestPath = bestPath;
+    s.bestPathLen = 0;
+    initMutex(&s.bestLock);
+    s.tasks = malloc(s.taskCapacity * sizeof(SearchTask));
+    s.prefixes = malloc(s.prefixesCapacity * sizeof(int));
+    s.deques = malloc(numThreads * sizeof(TaskDeque));
+    SearchWorker* workers = malloc(numThreads * sizeof(SearchWorker));
+    uint64_t* visited = createVisitedSet(g->numVertices);
+    int* path = malloc(g->numVertices * sizeof(int));
+
+    // Check if memory allocation was successful
+    if (!s.tasks || !s.prefixes || !s.deques || !workers || !path)
+    {
+        perror("Failed to allocate memory for parallel search");
+        exit(EXIT_FAILURE);
+    }
+
+    // Go deeper until there are enough subtrees to keep every thread busy
+    int target = numThreads * 16;
+    int depth = 0;
+    for (int d = 1; d < 32; d++)
+    {
+        int count = countSearchTasks(g, startVertex, visited, d, target);
+        if (count == 0) break;
+        depth = d;
+        if (count >= target) break;
+    }
+
+    path[0] = startVertex;
+    splitSearch(&s, visited, path, 1, vertexValue(g, startVertex), depth);
+    free(visited);
+    free(path);
+
+    // Give each worker a contiguous block of tasks
+    for (int w = 0; w < numThreads; w++)
+    {
+        initMutex(&s.deques[w].lock);
+        s.deques[w].head = (int)((long long)s.numTasks * w / numThreads);
+        s.deques[w].tail = (int)((long long)s.numTasks * (w + 1) / numThreads);
+
+        workers[w].search = &s;
+        workers[w].index = w;
+        memset(&workers[w].stats, 0, sizeof(SearchStats));
+        workers[w].counters = searchStats ? &workers[w].stats : NULL;
+        workers[w].visited = createVisitedSet(g->numVertices);
+        workers[w].path = malloc(g->numVertices * sizeof(int));
+        workers[w].frames = createSearchFrames(g);
+        if (!workers[w].visited || !workers[w].path)
+        {
+            perror("Failed to allocate memory for parallel search");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // The calling thread works as worker 0; if a thread cannot be started, the others steal its tasks
+    int started = 1;
+    while (started < numThreads && startThread(&workers[started].thread, searchWorker, &workers[started]))
+    {
+        started++;
+    }
+    searchWorker(&workers[0]);
+    for (int w = 1; w < started; w++)
+    {
+        joinThread(workers[w].thread);
+    }
+
+    *maxSum = (int)s.maxSum;
+    *bestPathLen = s.bestPathLen;
+
+    // Free the memory allocated for the search
+    for (int w = 0; w < numThreads; w++)
+    {
+        if (searchStats) mergeSearchStats(searchStats, &workers[w].stats);
+        destroyMutex(&s.deques[w].lock);
+        free(workers[w].visited);
+        free(workers[w].path);
+        free(workers[w].frames);
+    }
+    destroyMutex(&s.bestLock);
+    free(workers);
+    free(s.deques);
+    free(s.tasks);
+    free(s.prefixes);
+}
+#pragma endregion
+
+#pragma region Branch and Bound
+/// <summary>
+/// Struct to represent the state of a bounded backtracking search
+/// </summary>
+typedef struct
+{
+    Graph* g;
+    char* visited;
+    int* path;
+    int* maxSum;
+    int* bestPath;
+    int* bestPathLen;
+    long long positiveLeft; // Sum of the positive values of the vertices not on the path
+    int* mark;              // mark[v] == stamp when v was reached by the current bound computation
+    int stamp;
+    int* queue;
+    int* children;          // Stack of the sorted children of every vertex on the path
+    SearchFrame* frames;    // Vertices on the path from the root of the search, with the next child to try
+    long long* bounds;      // bounds[d]: highest sum any path through frame d can reach
+    long long pruned;
+    int target;             // Vertex the paths must end at, or -1 for paths ending anywhere
+    bool targetReached;     // The last bound computation reached the target
+} BoundedSearch;
+
+/// <summary>
+/// Function to compute the sum of the positive values that can still be added after a vertex, that is the values
+/// of the unvisited vertices reachable from it without going through the path
+/// </summary>
+/// <param name="b"></param>
+/// <param name="v"></param>
+/// <returns></returns>
+static long long reachablePositiveSum(BoundedSearch* b, int v)
+{
+    Graph* g = b->g;
+    long long sum = 0;
+    int head = 0, tail = 0;
+
+    b->stamp++;
+    b->queue[tail++] = v;
+    b->targetReached = v == b->target;
+    while (head < tail)
+    {
+        int u = b->queue[head++];
+        int numAdj = vertexDegree(g, u);
+        for (int i = 0; i < numAdj; i++)
+        {
+            int adj = vertexAdjacent(g, u, i);
+            if (!b->visited[adj] && b->mark[adj] != b->stamp)
+            {
+                b->mark[adj] = b->stamp;
+                b->queue[tail++] = adj;
+                if (adj == b->target) b->targetReached = true;
+                int value = vertexValue(g, adj);
+                if (value > 0) sum += value;
+            }
+        }
+    }
+    return sum;
+}
+
+/// <summary>
+/// Function to backtrack through the graph like dfsBacktraking, skipping the subtrees that cannot beat the best sum.
+/// The path is kept on the frame stack of the search, so long paths do not overflow the native stack.
+/// </summary>
+/// <param name="b"></param>
+/// <param name="v">Vertex the search starts from</param>
+/// <param name="pathIndex">Number of vertices already on the path before v</param>
+/// <param name="currentSum">Sum of the vertices already on the path</param>
+static void boundedBacktracking(BoundedSearch* b, int v, int pathIndex, int currentSum)
+{
+    Graph* g = b->g;
+    SearchFrame* frames = b->frames;
+    long long* bounds = b->bounds;
+    long long bound = LLONG_MAX; // Bound of the vertex being added to the path
+    int depth = 0, childrenLen = 0;
+    int shared = 0; // Length of the start of the path that is also the start of the best path
+
+    while (v >= 0 || depth > 0)
+    {
+        if (v >= 0)
+        {
+            // Mark the vertex as visited and add it to the path
+            int value = vertexValue(g, v);
+            b->visited[v] = 1;
+            b->path[pathIndex++] = v;
+            currentSum += value;
+            if (value > 0) b->positiveLeft -= value;
+            statsExpand(searchStats, pathIndex);
+
+            // If the current sum is greater than the maximum sum, update the maximum sum; only the part of the path
+            // that differs from the best path is copied, so a path that keeps improving is not copied at every step
+            if ((b->target < 0 || v == b->target) && currentSum > *b->maxSum)
+            {
+                *b->maxSum = currentSum;
+                *b->bestPathLen = pathIndex;
+                memcpy(b->bestPath + shared, b->path + shared, (pathIndex - shared) * sizeof(int));
+                shared = pathIndex;
+                statsImprovement(searchStats, currentSum);
+            }
+
+            // Collect the unvisited children, highest value first, so good paths are found early. A path that must
+            // end at the target does not go on after it.
+            int* children = b->children + childrenLen;
+            int numChildren = 0;
+            if (v == b->target)
+            {
+                statsPathCompleted(searchStats);
+            }
+            else
+            {
+                int numAdj = vertexDegree(g, v);
+                for (int i = 0; i < numAdj; i++)
+                {
+                    int adj = vertexAdjacent(g, v, i);
+                    if (b->visited[adj]) continue;
+
+                    int j = numChildren++;
+                    while (j > 0 && vertexValue(g, children[j - 1]) < vertexValue(g, adj))
+                    {
+                        children[j] = children[j - 1];
+                        j--;
+                    }
+                    children[j] = adj;
+                }
+                statsBacktrack(searchStats, numAdj - numChildren);
+                if (numChildren == 0 && b->target < 0) statsPathCompleted(searchStats);
+            }
+
+            bounds[depth] = bound;
+            frames[depth++] = (SearchFrame){ v, 0, numChildren, currentSum, false };
+            childrenLen += numChildren;
+            v = -1;
+            continue;
+        }
+
+        // Visit the next child of the last vertex on the path that can still win
+        SearchFrame* f = &frames[depth - 1];
+        int* children = b->children + childrenLen - f->numAdj;
+        while (f->next < f->numAdj)
+        {
+            // A path only wins with a sum above the maximum, so the other children are cut when even taking every
+            // positive value left cannot get there, or the bound of the vertex already cannot
+            if (f->sum + b->positiveLeft <= *b->maxSum || bounds[depth - 1] <= *b->maxSum)
+            {
+                b->pruned += f->numAdj - f->next;
+                statsBacktrack(searchStats, f->numAdj - f->next);
+                f->next = f->numAdj;
+                break;
+            }
+            int adj = children[f->next++];
+
+            // The vertices reachable from a child are reachable from its parent too, so a child can keep the bound of
+            // its parent. The reachable bound costs a search of its own, so it is only computed again where the path
+            // branches, and a path that does not branch is extended in linear time.
+            bound = bounds[depth - 1];
+            if (f->numAdj > 1)
+            {
+                b->visited[adj] = 1;
+                bound = f->sum + vertexValue(g, adj) + reachablePositiveSum(b, adj);
+                b->visited[adj] = 0;
+                if (bound <= *b->maxSum || (b->target >= 0 && !b->targetReached))
+                {
+                    b->pruned++;
+                    statsBacktrack(searchStats, 1);
+                    continue;
+                }
+            }
+
+            v = adj;
+            break;
+        }
+        if (v >= 0)
+        {
+            f->extended = true;
+            currentSum = f->sum;
+            continue;
+        }
+
+        // Backtrack
+        int value = vertexValue(g, f->vertex);
+        b->visited[f->vertex] = 0;
+        if (value > 0) b->positiveLeft += value;
+        pathIndex--;
+        if (shared > pathIndex) shared = pathIndex;
+        childrenLen -= f->numAdj;
+        depth--;
+    }
+}
+
+/// <summary>
+/// Function to allocate the buffers of a bounded search
+/// </summary>
+/// <param name="b"></param>
+/// <param name="g"></param>
+static void initBoundedSearch(BoundedSearch* b, Graph* g)
+{
+    b->g = g;
+    b->positiveLeft = 0;
+    b->stamp = 0;
+    b->pruned = 0;
+    b->target = -1;
+    b->targetReached = false;
+
+    // The children stack never holds more than all the edges
+    int numEdges = 0;
+    for (int i = 0; i < g->numVertices; i++)
+    {
+        int value = vertexValue(g, i);
+        if (value > 0) b->positiveLeft += value;
+        numEdges += vertexDegree(g, i);
+    }
+
+    b->visited = calloc(g->numVertices, sizeof(char));
+    b->path = malloc(g->numVertices * sizeof(int));
+    b->mark = calloc(g->numVertices, sizeof(int));
+    b->queue = malloc(g->numVertices * sizeof(int));
+    b->children = malloc((numEdges > 0 ? numEdges : 1) * sizeof(int));
+    b->frames = createSearchFrames(g);
+    b->bounds = malloc((g->numVertices > 0 ? g->numVertices : 1) * sizeof(long long));
+
+    // Check if memory allocation was successful
+    if (!b->visited || !b->path || !b->mark || !b->queue || !b->children || !b->bounds)
+    {
+        perror("Failed to allocate memory for bounded search");
+        exit(EXIT_FAILURE);
+    }
+}
+
+/// <summary>
+/// Function to free the buffers of a bounded search
+/// </summary>
+/// <param name="b"></param>
+static void freeBoundedSearch(BoundedSearch* b)
+{
+    free(b->visited);
+    free(b->path);
+    free(b->mark);
+    free(b->queue);
+    free(b->children);
+    free(b->frames);
+    free(b->bounds);
+}
+
+/// <summary>
+/// Function to find the highest sum path with a branch-and-bound backtracking search. It finds the same sum as
+/// dfsBacktraking, but among paths with the same sum it may return a different one since children are visited
+/// by value.
+/// </summary>
+/// <param name="g"></param>
+/// <param name="startVertex"></param>
+/// <param name="maxSum"></param>
+/// <param name="bestPath"></param>
+/// <param name="bestPathLen"></param>
+/// <param name="pruned">Number of subtrees that were cut</param>
+void dfsBounded(Graph* g, int startVertex, int* maxSum, int bestPath[], int* bestPathLen, long long* pruned)
+{
+    BoundedSearch b;
+    initBoundedSearch(&b, g);
+    b.maxSum = maxSum;
+    b.bestPath = bestPath;
+    b.bestPathLen = bestPathLen;
+
+    *maxSum = 0;
+    *bestPathLen = 0;
+    double start = statsPhaseBegin();
+    statsSearchStarted(searchStats, "branch-and-bound");
+    boundedBacktracking(&b, startVertex, 0, 0);
+    statsPhaseEnd(PHASE_SEARCH, start);
+    *pruned = b.pruned;
+
+    // Free the memory allocated for the search
+    freeBoundedSearch(&b);
+}
+#pragma endregion
+
+#pragma region Top-K Paths
+/// <summary>
+/// Struct to represent one of the k best paths to a vertex in the k-best dynamic programming
+/// </summary>
+typedef struct
+{
+    int sum;
+    int pred;     // Previous vertex, -1 at the source
+    int predRank; // Rank of the path to pred that this path extends
+} RankedPath;
+
+/// <summary>
+/// Function to find the k highest sum paths from a source to a destination in an acyclic graph, keeping the k best
+/// paths to every vertex in topological order. Runs in O((V+E) k).
 /// </summary>
-typedef struct node
+/// <returns>Number of paths found</returns>
+static int topKPathsDag(Graph* g, int src, int dst, int k, const int order[], int orderLen,
+    int sums[], int paths[], int pathLens[])
 {
-    int id;
-    int value;
-    int numAdj;
-    struct node** adjacents;
-} Node;
+    int n = g->numVertices;
+    char* canReach = calloc(n, sizeof(char));
+    int* slot = malloc(n * sizeof(int));
+    int* lastFrom = malloc(n * sizeof(int));
+
+    // Check if memory allocation was successful
+    if (!canReach || !slot || !lastFrom)
+    {
+        perror("Failed to allocate memory for top-k paths");
+        exit(EXIT_FAILURE);
+    }
+
+    // Only the vertices between the source and the destination get a list of ranked paths
+    markCanReach(g, order, orderLen, dst, canReach);
+    int numSlots = 0;
+    for (int i = 0; i < orderLen; i++)
+    {
+        int v = order[i];
+        slot[v] = canReach[v] ? numSlots++ : -1;
+        lastFrom[v] = -1;
+    }
+
+    RankedPath* ranked = malloc(((size_t)numSlots * k + k) * sizeof(RankedPath));
+    int* numRanked = calloc(numSlots + 1, sizeof(int));
+    if (!ranked || !numRanked)
+    {
+        perror("Failed to allocate memory for top-k paths");
+        exit(EXIT_FAILURE);
+    }
+    RankedPath* merged = ranked + (size_t)numSlots * k; // Scratch list used while merging
+
+    int found = 0;
+    if (canReach[src])
+    {
+        ranked[(size_t)slot[src] * k] = (RankedPath){ vertexValue(g, src), -1, -1 };
+        numRanked[slot[src]] = 1;
+
+        for (int i = 0; i < orderLen; i++)
+        {
+            int v = order[i];
+            if (!canReach[v] || v == dst || numRanked[slot[v]] == 0) continue;
+            statsExpand(searchStats, 0);
+
+            RankedPath* from = ranked + (size_t)slot[v] * k;
+            int numFrom = numRanked[slot[v]];
+            int numAdj = vertexDegree(g, v);
+            for (int j = 0; j < numAdj; j++)
+            {
+                int adj = vertexAdjacent(g, v, j);
+
+                // Repeated edges would give the same paths twice
+                if (!canReach[adj] || lastFrom[adj] == v) continue;
+                lastFrom[adj] = v;
+
+                // Merge the paths to v, extended by adj, into the sorted list of adj
+                RankedPath* to = ranked + (size_t)slot[adj] * k;
+                int numTo = numRanked[slot[adj]];
+                int value = vertexValue(g, adj);
+                int a = 0, b = 0, m = 0;
+                while (m < k && (a < numTo || b < numFrom))
+                {
+                    if (b == numFrom || (a < numTo && to[a].sum >= from[b].sum + value))
+                    {
+                        merged[m++] = to[a++];
+                    }
+                    else
+                    {
+                        merged[m++] = (RankedPath){ from[b].sum + value, v, b };
+                        b++;
+                    }
+                }
+                memcpy(to, merged, m * sizeof(RankedPath));
+                numRanked[slot[adj]] = m;
+            }
+        }
+
+        // Rebuild each path at the destination by following the predecessors
+        found = numRanked[slot[dst]];
+        for (int r = 0; r < found; r++)
+        {
+            int* path = paths + (size_t)r * n;
+            int len = 0;
+            sums[r] = ranked[(size_t)slot[dst] * k + r].sum;
+            for (int v = dst, rank = r; v != -1; )
+            {
+                RankedPath* entry = &ranked[(size_t)slot[v] * k + rank];
+                path[len++] = v;
+                v = entry->pred;
+                rank = entry->predRank;
+            }
+            for (int i = 0, j = len - 1; i < j; i++, j--)
+            {
+                int temp = path[i];
+                path[i] = path[j];
+                path[j] = temp;
+            }
+            pathLens[r] = len;
+            statsPathCompleted(searchStats);
+        }
+    }
+
+    free(canReach);
+    free(slot);
+    free(lastFrom);
+    free(ranked);
+    free(numRanked);
+    return found;
+}
 
 /// <summary>
-/// Struct to represent a graph
+/// Function to add a vertex to the end of the root path of a bounded search
 /// </summary>
-typedef struct
+/// <param name="b"></param>
+/// <param name="v"></param>
+/// <param name="rootLen">Number of vertices already on the root path</param>
+static void pushRootVertex(BoundedSearch* b, int v, int rootLen)
 {
-    Node** vertices;
-    int numVertices;
-    int size;
-} Graph;
-#pragma endregion
+    int value = vertexValue(b->g, v);
+    b->visited[v] = 1;
+    b->path[rootLen] = v;
+    if (value > 0) b->positiveLeft -= value;
+}
 
-#pragma region Vertex
 /// <summary>
-/// Function to add a vertex to a graph
+/// Function to take the whole root path of a bounded search back out
 /// </summary>
-/// <param name="g"></param>
-/// <param name="value"></param>
-void addVertex(Graph* g, int value)
+/// <param name="b"></param>
+/// <param name="rootLen"></param>
+static void clearRootPath(BoundedSearch* b, int rootLen)
 {
-    // If the number of vertices is equal to the size of the array, reallocate memory
-    if (g->numVertices == g->size)
+    for (int i = 0; i < rootLen; i++)
     {
-        // Double the size of the array
-        g->size *= 2;
-        // Reallocate memory for the array of vertices
-        Node** temp = realloc(g->vertices, g->size * sizeof(Node*));
+        int value = vertexValue(b->g, b->path[i]);
+        b->visited[b->path[i]] = 0;
+        if (value > 0) b->positiveLeft += value;
+    }
+}
 
-        // Check if memory reallocation was successful
-        if (!temp)
+/// <summary>
+/// Function to find the highest sum path to the target of a bounded search that starts with the root path put in
+/// place by pushRootVertex and does not leave the last root vertex (the spur vertex) through a banned vertex
+/// </summary>
+/// <param name="b">Bounded search with a target, its maxSum/bestPath/bestPathLen receive the path</param>
+/// <param name="rootLen"></param>
+/// <param name="rootSum">Sum of the values on the root path</param>
+/// <param name="banned"></param>
+/// <returns>true if such a path exists</returns>
+static bool spurSearch(BoundedSearch* b, int rootLen, int rootSum, const char banned[])
+{
+    Graph* g = b->g;
+    int spur = b->path[rootLen - 1];
+
+    *b->maxSum = INT_MIN;
+    *b->bestPathLen = 0;
+    if (spur == b->target)
+    {
+        *b->maxSum = rootSum;
+        *b->bestPathLen = rootLen;
+        memcpy(b->bestPath, b->path, rootLen * sizeof(int));
+    }
+    else
+    {
+        int numAdj = vertexDegree(g, spur);
+        for (int i = 0; i < numAdj; i++)
         {
-            perror("Failed to reallocate memory for vertices");
-            exit(EXIT_FAILURE);
+            int adj = vertexAdjacent(g, spur, i);
+            if (!b->visited[adj] && !banned[adj])
+            {
+                boundedBacktracking(b, adj, rootLen, rootSum);
+            }
         }
-        g->vertices = temp;
     }
+    return *b->bestPathLen > 0;
+}
 
-    // Create a new node
-    Node* newNode = malloc(sizeof(Node));
+/// <summary>
+/// Function to find the k highest sum simple paths from a source to a destination in any graph with Yen's algorithm,
+/// using the bounded backtracking search for each spur path
+/// </summary>
+/// <returns>Number of paths found</returns>
+static int topKPathsYen(Graph* g, int src, int dst, int k, int sums[], int paths[], int pathLens[])
+{
+    int n = g->numVertices;
+    int spurSum, spurLen;
+    int* spurPath = malloc(n * sizeof(int));
+    char* banned = calloc(n, sizeof(char));
+    char* sameRoot = malloc(k * sizeof(char)); // sameRoot[r]: path r starts like the previous path up to the spur
+
+    // Candidate paths are kept back to back in a pool, in the order they were found
+    int numCandidates = 0, candidateCapacity = 16;
+    size_t poolLen = 0, poolCapacity = 16 * (size_t)n;
+    int* pool = malloc(poolCapacity * sizeof(int));
+    size_t* candidateStart = malloc(candidateCapacity * sizeof(size_t));
+    int* candidateLens = malloc(candidateCapacity * sizeof(int));
+    int* candidateSums = malloc(candidateCapacity * sizeof(int));
 
     // Check if memory allocation was successful
-    if (!newNode)
+    if (!spurPath || !banned || !sameRoot || !pool || !candidateStart || !candidateLens || !candidateSums)
     {
-        perror("Failed to allocate memory for new node");
+        perror("Failed to allocate memory for top-k paths");
         exit(EXIT_FAILURE);
     }
 
-    newNode->id = g->numVertices;
-    newNode->value = value;
-    newNode->adjacents = NULL;
-    newNode->numAdj = 0;
-    g->vertices[g->numVertices++] = newNode;
+    BoundedSearch b;
+    initBoundedSearch(&b, g);
+    b.target = dst;
+    b.maxSum = &spurSum;
+    b.bestPath = spurPath;
+    b.bestPathLen = &spurLen;
+
+    // The best path comes first
+    int found = 0;
+    pushRootVertex(&b, src, 0);
+    if (spurSearch(&b, 1, vertexValue(g, src), banned))
+    {
+        sums[0] = spurSum;
+        pathLens[0] = spurLen;
+        memcpy(paths, spurPath, spurLen * sizeof(int));
+        found = 1;
+    }
+    clearRootPath(&b, 1);
+
+    while (found > 0 && found < k)
+    {
+        const int* prev = paths + (size_t)(found - 1) * n;
+        int prevLen = pathLens[found - 1];
+        memset(sameRoot, 1, found * sizeof(char));
+
+        // Deviate from the previous path at each of its vertices, growing the root path by one vertex each time
+        int rootSum = 0;
+        for (int j = 0; j < prevLen - 1; j++)
+        {
+            pushRootVertex(&b, prev[j], j);
+            rootSum += vertexValue(g, prev[j]);
+
+            // Paths already found with the same root cannot leave the spur vertex the same way
+            for (int r = 0; r < found; r++)
+            {
+                const int* path = paths + (size_t)r * n;
+                sameRoot[r] = sameRoot[r] && pathLens[r] > j && path[j] == prev[j];
+                if (sameRoot[r] && pathLens[r] > j + 1) banned[path[j + 1]] = 1;
+            }
+
+            bool ok = spurSearch(&b, j + 1, rootSum, banned);
+            for (int r = 0; r < found; r++)
+            {
+                if (sameRoot[r] && pathLens[r] > j + 1) banned[paths[(size_t)r * n + j + 1]] = 0;
+            }
+            if (!ok) continue;
+
+            // Skip candidates that were already found from another spur
+            bool duplicate = false;
+            for (int c = 0; c < numCandidates && !duplicate; c++)
+            {
+                duplicate = candidateLens[c] == spurLen && candidateSums[c] == spurSum
+                    && memcmp(pool + candidateStart[c], spurPath, spurLen * sizeof(int)) == 0;
+            }
+            if (duplicate) continue;
+
+            // Grow the candidate arrays when they are full
+            if (numCandidates == candidateCapacity)
+            {
+                candidateCapacity *= 2;
+                size_t* starts = realloc(candidateStart, candidateCapacity * sizeof(size_t));
+                int* lens = realloc(candidateLens, candidateCapacity * sizeof(int));
+                int* candSums = realloc(candidateSums, candidateCapacity * sizeof(int));
+                if (!starts || !lens || !candSums)
+                {
+                    perror("Failed to reallocate memory for top-k paths");
+                    exit(EXIT_FAILURE);
+                }
+                candidateStart = starts;
+                candidateLens = lens;
+                candidateSums = candSums;
+            }
+            if (poolLen + spurLen > poolCapacity)
+            {
+                poolCapacity = poolCapacity * 2 + spurLen;
+                int* temp = realloc(pool, poolCapacity * sizeof(int));
+                if (!temp)
+                {
+                    perror("Failed to reallocate memory for top-k paths");
+                    exit(EXIT_FAILURE);
+                }
+                pool = temp;
+            }
+
+            memcpy(pool + poolLen, spurPath, spurLen * sizeof(int));
+            candidateStart[numCandidates] = poolLen;
+            candidateLens[numCandidates] = spurLen;
+            candidateSums[numCandidates] = spurSum;
+            poolLen += spurLen;
+            numCandidates++;
+        }
+
+        clearRootPath(&b, prevLen - 1);
+        if (numCandidates == 0) break;
+
+        // The best candidate (the first found on ties) is the next path
+        int best = 0;
+        for (int c = 1; c < numCandidates; c++)
+        {
+            if (candidateSums[c] > candidateSums[best]) best = c;
+        }
+        sums[found] = candidateSums[best];
+        pathLens[found] = candidateLens[best];
+        memcpy(paths + (size_t)found * n, pool + candidateStart[best], candidateLens[best] * sizeof(int));
+        found++;
+
+        // Remove it from the candidates, keeping their order
+        numCandidates--;
+        memmove(candidateStart + best, candidateStart + best + 1, (numCandidates - best) * sizeof(size_t));
+        memmove(candidateLens + best, candidateLens + best + 1, (numCandidates - best) * sizeof(int));
+        memmove(candidateSums + best, candidateSums + best + 1, (numCandidates - best) * sizeof(int));
+    }
+
+    freeBoundedSearch(&b);
+    free(spurPath);
+    free(banned);
+    free(sameRoot);
+    free(pool);
+    free(candidateStart);
+    free(candidateLens);
+    free(candidateSums);
+    return found;
 }
 
 /// <summary>
-/// Function to remove a vertex from a graph
+/// Function to find the k highest sum distinct paths from a source to a destination, best first. Acyclic graphs use
+/// a k-best dynamic programming pass, other graphs use Yen's algorithm.
 /// </summary>
 /// <param name="g"></param>
-/// <param name="vertexIndex"></param>
-void removeVertex(Graph* g, int vertexIndex)
+/// <param name="src"></param>
+/// <param name="dst"></param>
+/// <param name="k"></param>
+/// <param name="sums">Sum of each path found</param>
+/// <param name="paths">Room for k paths of g->numVertices vertices, path r starts at paths[r * g->numVertices]</param>
+/// <param name="pathLens">Number of vertices of each path found</param>
+/// <returns>Number of paths found, at most k</returns>
+int topKPaths(Graph* g, int src, int dst, int k, int sums[], int paths[], int pathLens[])
 {
     // Check if the vertex Index's are valid
-    if (vertexIndex < 0 || vertexIndex >= g->numVertices)
+    if (!vertexExists(g, src) || !vertexExists(g, dst) || k <= 0)
     {
-        printf("Invalid vertex index.\n");
-        return;
+        return 0;
     }
 
-    // Get the vertex to be removed
-    Node* vertexToRemove = g->vertices[vertexIndex];
+    int* order = malloc(g->numVertices * sizeof(int));
+    int orderLen = 0;
 
-    // First, remove all edges from other vertices pointing to this vertex
-    for (int i = 0; i < g->numVertices; i++)
+    // Check if memory allocation was successful
+    if (!order)
     {
-        if (i == vertexIndex) continue; // Skip the vertex being removed
-        Node* vertex = g->vertices[i];
+        perror("Failed to allocate memory for top-k paths");
+        exit(EXIT_FAILURE);
+    }
 
-        int j = 0;
-        while (j < vertex->numAdj) {
-            if (vertex->adjacents[j]->id == vertexToRemove->id)
+    double start = statsPhaseBegin();
+    bool acyclic = topologicalSort(g, src, order, &orderLen);
+    statsSearchStarted(searchStats, acyclic ? "top-k-dag" : "top-k-yen");
+    int found = acyclic
+        ? topKPathsDag(g, src, dst, k, order, orderLen, sums, paths, pathLens)
+        : topKPathsYen(g, src, dst, k, sums, paths, pathLens);
+    statsPhaseEnd(PHASE_SEARCH, start);
+
+    free(order);
+    return found;
+}
+#pragma endregion
+
+#pragma region Point to Point Paths
+/// <summary>
+/// Function to get the point to point tables of a source vertex, building them if they are not cached. When the cache
+/// is full the tables used least recently make room.
+/// </summary>
+/// <param name="g"></param>
+/// <param name="source"></param>
+/// <returns></returns>
+static PathTables* sourcePathTables(Graph* g, int source)
+{
+    PathTableCache* c = g->pathTables;
+    if (!c)
+    {
+        c = calloc(1, sizeof(PathTableCache));
+        if (!c)
+        {
+            perror("Failed to allocate memory for path tables");
+            exit(EXIT_FAILURE);
+        }
+        g->pathTables = c;
+    }
+    c->clock++;
+
+    PathTables* t = NULL;
+    for (int i = 0; i < c->numEntries; i++)
+    {
+        if (c->entries[i].source == source)
+        {
+            c->entries[i].lastUse = c->clock;
+            return &c->entries[i];
+        }
+        if (!t || c->entries[i].lastUse < t->lastUse) t = &c->entries[i];
+    }
+    int limit = g->numVertices > 0 ? MAX_CACHED_TABLE_VERTICES / g->numVertices : MAX_CACHED_SOURCES;
+    if (c->numEntries < MAX_CACHED_SOURCES && (c->numEntries < limit || c->numEntries == 0))
+    {
+        t = &c->entries[c->numEntries++];
+    }
+    else
+    {
+        free(t->best);
+        free(t->pred);
+    }
+
+    int n = g->numVertices;
+    int* order = malloc(n * sizeof(int));
+    t->source = source;
+    t->lastUse = c->clock;
+    t->best = malloc(n * sizeof(int));
+    t->pred = malloc(n * sizeof(int));
+    int orderLen = 0;
+
+    // Check if memory allocation was successful
+    if (!order || !t->best || !t->pred)
+    {
+        perror("Failed to allocate memory for path tables");
+        exit(EXIT_FAILURE);
+    }
+
+    // With a cycle in reach the tables stay empty and each query runs its own search
+    double start = statsPhaseBegin();
+    t->acyclic = topologicalSort(g, source, order, &orderLen);
+    for (int v = 0; v < n; v++)
+    {
+        t->pred[v] = -2;
+    }
+    if (t->acyclic)
+    {
+        // Same dynamic programming as dagHighestSum, keeping the tables of every reachable vertex
+        for (int i = 0; i < orderLen; i++)
+        {
+            t->pred[order[i]] = -1;
+        }
+        t->best[source] = vertexValue(g, source);
+        for (int i = 0; i < orderLen; i++)
+        {
+            int v = order[i];
+            int numAdj = vertexDegree(g, v);
+            statsExpand(searchStats, 0);
+
+            for (int j = 0; j < numAdj; j++)
             {
-                // Shift all elements to the left to overwrite the current position
-                for (int k = j; k < vertex->numAdj - 1; k++)
+                int adj = vertexAdjacent(g, v, j);
+                int sum = t->best[v] + vertexValue(g, adj);
+                if (t->pred[adj] == -1 || sum > t->best[adj])
                 {
-                    vertex->adjacents[k] = vertex->adjacents[k + 1];
+                    t->best[adj] = sum;
+                    t->pred[adj] = v;
                 }
-                vertex->numAdj--; // Decrease the count of adjacents
-            }
-            else {
-                j++; // Only increment if no deletion was made to keep the index correct
             }
         }
     }
+    statsPhaseEnd(PHASE_BUILD, start);
+
+    free(order);
+    return t;
+}
+
+/// <summary>
+/// Function to find the highest sum path between two vertices with the tables of the source vertex
+/// </summary>
+/// <param name="g"></param>
+/// <param name="t"></param>
+/// <param name="dst"></param>
+/// <param name="sum"></param>
+/// <param name="bestPath">Room for g->numVertices vertices</param>
+/// <param name="bestPathLen"></param>
+/// <returns>true if the destination can be reached from the source</returns>
+static bool pathFromTables(Graph* g, PathTables* t, int dst, int* sum, int bestPath[], int* bestPathLen)
+{
+    *sum = 0;
+    *bestPathLen = 0;
+
+    // Graphs with cycles need a search for every pair
+    if (!t->acyclic)
+    {
+        return topKPaths(g, t->source, dst, 1, sum, bestPath, bestPathLen) > 0;
+    }
+    if (t->pred[dst] == -2) return false;
 
-    // Free the memory allocated for the adjacent vertices of the vertex to be removed
-    free(vertexToRemove->adjacents);
+    // Rebuild the path by following the predecessors back to the source
+    double start = statsPhaseBegin();
+    *sum = t->best[dst];
+    for (int v = dst; v != -1; v = t->pred[v])
+    {
+        bestPath[(*bestPathLen)++] = v;
+    }
+    for (int i = 0, j = *bestPathLen - 1; i < j; i++, j--)
+    {
+        int temp = bestPath[i];
+        bestPath[i] = bestPath[j];
+        bestPath[j] = temp;
+    }
+    statsPathCompleted(searchStats);
+    statsPhaseEnd(PHASE_SEARCH, start);
+    return true;
+}
 
-    // Free the memory allocated for the vertex itself
-    free(vertexToRemove);
+/// <summary>
+/// Function to find the highest sum path from a source vertex to a destination vertex, whatever the sign of its sum.
+/// On acyclic graphs the tables of the source are kept until the graph changes, so later queries from the same
+/// source only walk back the path.
+/// </summary>
+/// <param name="g"></param>
+/// <param name="src"></param>
+/// <param name="dst"></param>
+/// <param name="sum"></param>
+/// <param name="bestPath">Room for g->numVertices vertices</param>
+/// <param name="bestPathLen"></param>
+/// <returns>true if the destination can be reached from the source</returns>
+bool bestPathBetween(Graph* g, int src, int dst, int* sum, int bestPath[], int* bestPathLen)
+{
+    *sum = 0;
+    *bestPathLen = 0;
 
-    // Shift all vertices after the removed vertex one position to the left
-    for (int i = vertexIndex; i < g->numVertices - 1; i++)
+    // Check if the vertex Index's are valid
+    if (!vertexExists(g, src) || !vertexExists(g, dst))
     {
-        g->vertices[i] = g->vertices[i + 1];
-        g->vertices[i]->id = i; // Update the ID of each vertex to reflect their new position
+        return false;
     }
 
-    g->numVertices--; // Decrease the total number of vertices in the graph
+    statsSearchStarted(searchStats, "point-to-point");
+    return pathFromTables(g, sourcePathTables(g, src), dst, sum, bestPath, bestPathLen);
 }
 
 /// <summary>
-/// Function to add a vertex at the start of the graph
+/// Function to compare two pairs of ints by their first int, then by their second one, for qsort
+/// </summary>
+/// <param name="a"></param>
+/// <param name="b"></param>
+/// <returns></returns>
+static int comparePairs(const void* a, const void* b)
+{
+    const int* x = a;
+    const int* y = b;
+    if (x[0] != y[0]) return x[0] < y[0] ? -1 : 1;
+    return x[1] < y[1] ? -1 : x[1] > y[1];
+}
+
+/// <summary>
+/// Function to find the highest sum paths of many source and destination pairs, see bestPathBetween. The queries
+/// are grouped by source, so each source is solved once however many pairs use it and the cache holds.
 /// </summary>
 /// <param name="g"></param>
-/// <param name="value"></param>
-void addVertexAtStart(Graph* g, int value)
+/// <param name="pairs">Source and destination of each query</param>
+/// <param name="numPairs"></param>
+/// <param name="sums">Sum of the path of each query</param>
+/// <param name="pathLens">Number of vertices of the path of each query, 0 if there is no path</param>
+/// <param name="paths">Set to the paths of the queries one after the other, in query order, to be freed by the caller</param>
+/// <returns>Number of queries with a path</returns>
+int bestPathsBetween(Graph* g, const int (*pairs)[2], int numPairs, int sums[], int pathLens[], int** paths)
 {
-    // Check if the number of vertices is equal to the size of the array
-    if (g->numVertices == g->size)
+    int (*queries)[2] = malloc((numPairs > 0 ? numPairs : 1) * sizeof(*queries));
+    int* path = malloc(g->numVertices * sizeof(int));
+    size_t* starts = malloc((numPairs > 0 ? numPairs : 1) * sizeof(size_t));
+    size_t used = 0, capacity = 1024;
+    int* found = malloc(capacity * sizeof(int));
+
+    // Check if memory allocation was successful
+    if (!queries || !path || !starts || !found)
     {
-        // Double the size of the array
-        g->size *= 2;
+        perror("Failed to allocate memory for point to point queries");
+        exit(EXIT_FAILURE);
+    }
+    statsSearchStarted(searchStats, "point-to-point");
 
-        // Reallocate memory for the array of vertices
-        Node** temp = realloc(g->vertices, g->size * sizeof(Node*));
+    for (int i = 0; i < numPairs; i++)
+    {
+        queries[i][0] = pairs[i][0];
+        queries[i][1] = i;
+    }
+    qsort(queries, numPairs, sizeof(*queries), comparePairs);
 
-        // Check if memory reallocation was successful
-        if (!temp)
+    // Answer each group of queries with the tables of its source, keeping the paths in group order for now
+    int numFound = 0;
+    PathTables* t = NULL;
+    for (int q = 0; q < numPairs; q++)
+    {
+        int i = queries[q][1];
+        int src = pairs[i][0], dst = pairs[i][1];
+        sums[i] = 0;
+        pathLens[i] = 0;
+        starts[i] = used;
+        if (!vertexExists(g, src) || !vertexExists(g, dst)) continue;
+        if (!t || t->source != src) t = sourcePathTables(g, src);
+        if (!pathFromTables(g, t, dst, &sums[i], path, &pathLens[i])) continue;
+
+        numFound++;
+        if (used + pathLens[i] > capacity)
         {
-            perror("Failed to reallocate memory for vertices");
-            exit(EXIT_FAILURE);
+            while (used + pathLens[i] > capacity) capacity *= 2;
+            int* temp = realloc(found, capacity * sizeof(int));
+            if (!temp)
+            {
+                perror("Failed to reallocate memory for point to point queries");
+                exit(EXIT_FAILURE);
+            }
+            found = temp;
         }
-        g->vertices = temp;
+        memcpy(found + used, path, pathLens[i] * sizeof(int));
+        used += pathLens[i];
     }
 
-    // Shift all vertices one position to the right
-    for (int i = g->numVertices; i > 0; i--)
+    // Put the paths back in query order
+    *paths = malloc((used > 0 ? used : 1) * sizeof(int));
+    if (!*paths)
     {
-        g->vertices[i] = g->vertices[i - 1];
+        perror("Failed to allocate memory for point to point paths");
+        exit(EXIT_FAILURE);
     }
-
-    // Create a new node for the first position
-    Node* newNode = malloc(sizeof(Node));
-    if (!newNode)
+    size_t next = 0;
+    for (int i = 0; i < numPairs; i++)
     {
-        perror("Failed to allocate memory for new node");
-        exit(EXIT_FAILURE);
+        memcpy(*paths + next, found + starts[i], pathLens[i] * sizeof(int));
+        next += pathLens[i];
     }
 
-    newNode->id = 0; // Assign ID 0 to the new first vertex
-    newNode->value = value;
-    newNode->adjacents = NULL;
-    newNode->numAdj = 0;
-    g->vertices[0] = newNode;
+    free(queries);
+    free(path);
+    free(starts);
+    free(found);
+    return numFound;
+}
+#pragma endregion
 
-    // Update IDs for all vertices
-    for (int i = 1; i <= g->numVertices; i++)
-    {
-        g->vertices[i]->id = i;
-    }
+#pragma region Vertex Reordering
+/// <summary>
+/// Order reorderGraph gives the vertices
+/// </summary>
+typedef enum
+{
+    REORDER_BFS,    // Breadth-first along the edges, from the first vertex, so a search meets the vertices in id order
+    REORDER_RCM,    // Reverse Cuthill-McKee, which keeps the ids of neighbours close whatever the direction of the edge
+    REORDER_HILBERT // The cells along a Hilbert curve, for graphs loaded as a grid
+} ReorderStrategy;
 
-    g->numVertices++;
+/// <summary>
+/// Function to get the number of neighbours of a vertex, counting the edges in both directions
+/// (frozen graphs need buildReverseIndex first)
+/// </summary>
+/// <param name="g"></param>
+/// <param name="v"></param>
+/// <returns></returns>
+static inline int undirectedDegree(const Graph* g, int v)
+{
+    return vertexDegree(g, v) + vertexInDegree(g, v);
 }
 
 /// <summary>
-/// Function to add a vertex at the end of the graph
+/// Function to get the i-th neighbour of a vertex, the adjacent vertices first and then the predecessors
 /// </summary>
 /// <param name="g"></param>
-/// <param name="value"></param>
-void addVertexAtEnd(Graph* g, int value) {
-    addVertex(g, value);
+/// <param name="v"></param>
+/// <param name="i"></param>
+/// <returns></returns>
+static inline int undirectedNeighbour(const Graph* g, int v, int i)
+{
+    int numAdj = vertexDegree(g, v);
+    return i < numAdj ? vertexAdjacent(g, v, i) : vertexPredecessor(g, v, i - numAdj);
 }
 
 /// <summary>
-/// Function to update the value of a vertex in a graph
+/// Function to number the vertices breadth-first along the edges. The vertices the first one cannot reach start new
+/// searches, in start to end order.
 /// </summary>
 /// <param name="g"></param>
-/// <param name="vertexId"></param>
-/// <param name="newValue"></param>
-void updateVertexValue(Graph* g, int vertexId, int newValue)
+/// <param name="order">Receives the vertices in their new order</param>
+/// <param name="placed">Empty visited set from createVisitedSet</param>
+/// <returns>Number of vertices placed</returns>
+static int bfsOrder(Graph* g, int order[], uint64_t placed[])
 {
-    // Check if the vertex ID is valid
-    if (vertexId < 0 || vertexId >= g->numVertices) {
-        printf("Invalid vertex ID.\n");
-        return;
-    }
+    int numPlaced = 0;
+    for (int seed = firstVertex(g); seed >= 0; seed = nextVertex(g, seed))
+    {
+        if (isVisited(placed, seed)) continue;
 
-    // Update the value of the vertex
-    Node* vertex = g->vertices[vertexId];
-    vertex->value = newValue;
+        int head = numPlaced;
+        order[numPlaced++] = seed;
+        markVisited(placed, seed);
+        while (head < numPlaced)
+        {
+            int v = order[head++];
+            int numAdj = vertexDegree(g, v);
+            for (int i = 0; i < numAdj; i++)
+            {
+                int adj = vertexAdjacent(g, v, i);
+                if (!isVisited(placed, adj))
+                {
+                    markVisited(placed, adj);
+                    order[numPlaced++] = adj;
+                }
+            }
+        }
+    }
+    return numPlaced;
 }
-#pragma endregion
 
-#pragma region Edge
 /// <summary>
-/// Function to add an edge to a graph
+/// Function to run a breadth-first search over the edges in both directions, level by level
 /// </summary>
 /// <param name="g"></param>
-/// <param name="from"></param>
-/// <param name="to"></param>
-void addEdge(Graph* g, int from, int to)
+/// <param name="start"></param>
+/// <param name="queue">Receives the vertices reached</param>
+/// <param name="seen">seen[v] is set to round once v is reached</param>
+/// <param name="round">Value not used by seen yet</param>
+/// <param name="height">Receives the number of levels after the first</param>
+/// <param name="count">Receives the number of vertices reached</param>
+/// <returns>Position in queue of the first vertex of the last level</returns>
+static int undirectedLevels(Graph* g, int start, int queue[], int seen[], int round, int* height, int* count)
 {
-    // Check if the vertex Index's are valid
-    if (from < 0 || from >= g->numVertices || to < 0 || to >= g->numVertices)
+    int tail = 0, levelStart = 0;
+    queue[tail++] = start;
+    seen[start] = round;
+    *height = 0;
+
+    while (true)
     {
-        printf("Invalid vertex index.\n");
-        return;
+        int levelEnd = tail;
+        for (int i = levelStart; i < levelEnd; i++)
+        {
+            int v = queue[i];
+            int degree = undirectedDegree(g, v);
+            for (int j = 0; j < degree; j++)
+            {
+                int u = undirectedNeighbour(g, v, j);
+                if (seen[u] != round)
+                {
+                    seen[u] = round;
+                    queue[tail++] = u;
+                }
+            }
+        }
+        if (tail == levelEnd) break;
+        levelStart = levelEnd;
+        (*height)++;
     }
 
-    // Get the source vertex
-    Node* src = g->vertices[from];
-    Node** temp = realloc(src->adjacents, (src->numAdj + 1) * sizeof(Node*));
+    *count = tail;
+    return levelStart;
+}
 
-    // Check if memory reallocation was successful
-    if (!temp)
+/// <summary>
+/// Function to find a vertex at the far end of its component (George and Liu), where Cuthill-McKee starts
+/// </summary>
+/// <param name="g"></param>
+/// <param name="seed"></param>
+/// <param name="queue"></param>
+/// <param name="seen"></param>
+/// <param name="round">Last value used by seen, updated</param>
+/// <returns></returns>
+static int peripheralVertex(Graph* g, int seed, int queue[], int seen[], int* round)
+{
+    int v = seed, height, count;
+    int first = undirectedLevels(g, v, queue, seen, ++*round, &height, &count);
+
+    // Move to the vertex of lowest degree on the last level while that makes the component deeper
+    while (true)
     {
-        perror("Failed to reallocate memory for adjacents");
-        exit(EXIT_FAILURE);
-    }
+        int u = queue[first];
+        for (int i = first + 1; i < count; i++)
+        {
+            if (undirectedDegree(g, queue[i]) < undirectedDegree(g, u)) u = queue[i];
+        }
 
-    // Update the list of adjacent vertices
-    src->adjacents = temp;
-    src->adjacents[src->numAdj++] = g->vertices[to];
+        int uHeight, uCount;
+        int uFirst = undirectedLevels(g, u, queue, seen, ++*round, &uHeight, &uCount);
+        if (uHeight <= height) return v;
+        v = u;
+        height = uHeight;
+        first = uFirst;
+        count = uCount;
+    }
 }
 
 /// <summary>
-/// Function to remove an edge from a graph
+/// Function to number the vertices in reverse Cuthill-McKee order: breadth-first over the edges in both directions
+/// from a peripheral vertex, taking the neighbours by increasing degree, then reversed
 /// </summary>
 /// <param name="g"></param>
-/// <param name="from"></param>
-/// <param name="to"></param>
-void removeEdge(Graph* g, int from, int to)
+/// <param name="order">Receives the vertices in their new order</param>
+/// <param name="placed">Empty visited set from createVisitedSet</param>
+/// <returns>Number of vertices placed</returns>
+static int rcmOrder(Graph* g, int order[], uint64_t placed[])
 {
-    // Check if the vertex Index's are valid
-    if (from < 0 || from >= g->numVertices || to < 0 || to >= g->numVertices)
+    int n = g->numVertices;
+    int* queue = malloc((n > 0 ? n : 1) * sizeof(int));
+    int* seen = calloc(n > 0 ? n : 1, sizeof(int));
+    int (*pending)[2] = malloc((n > 0 ? n : 1) * sizeof(*pending));
+
+    // Check if memory allocation was successful
+    if (!queue || !seen || !pending)
     {
-        printf("Invalid vertex index.\n");
-        return;
+        perror("Failed to allocate memory for reordering");
+        exit(EXIT_FAILURE);
     }
 
-    Node* src = g->vertices[from]; // Get the source vertex
-
-    for (int i = 0; i < src->numAdj; i++)
+    int numPlaced = 0, round = 0;
+    for (int seed = firstVertex(g); seed >= 0; seed = nextVertex(g, seed))
     {
-        if (src->adjacents[i]->id == to)
+        if (isVisited(placed, seed)) continue;
+
+        int start = peripheralVertex(g, seed, queue, seen, &round);
+        int head = numPlaced;
+        order[numPlaced++] = start;
+        markVisited(placed, start);
+        while (head < numPlaced)
         {
-            // Found the edge, now remove it by shifting left the elements in the adjacency array
-            for (int j = i; j < src->numAdj - 1; j++)
+            int v = order[head++];
+            int degree = undirectedDegree(g, v);
+            int numPending = 0;
+            for (int i = 0; i < degree; i++)
             {
-                src->adjacents[j] = src->adjacents[j + 1];
+                int u = undirectedNeighbour(g, v, i);
+                if (!isVisited(placed, u))
+                {
+                    markVisited(placed, u);
+                    pending[numPending][0] = undirectedDegree(g, u);
+                    pending[numPending++][1] = u;
+                }
             }
 
-            src->numAdj--; // Decrease the count of adjacents
-            src->adjacents = realloc(src->adjacents, src->numAdj * sizeof(Node*)); // Optionally resize the memory
-
-            if (src->adjacents == NULL && src->numAdj > 0)
+            // Lowest degree first, then lowest id
+            qsort(pending, numPending, sizeof(*pending), comparePairs);
+            for (int i = 0; i < numPending; i++)
             {
-                perror("Failed to reallocate memory for adjacents");
-                exit(EXIT_FAILURE);
+                order[numPlaced++] = pending[i][1];
             }
-            printf("Edge removed successfully from %d to %d.\n", from, to);
-            return; // Exit the function after the edge is removed
         }
     }
 
-    printf("No edge found from %d to %d.\n", from, to);
+    for (int i = 0, j = numPlaced - 1; i < j; i++, j--)
+    {
+        int temp = order[i];
+        order[i] = order[j];
+        order[j] = temp;
+    }
+
+    free(queue);
+    free(seen);
+    free(pending);
+    return numPlaced;
 }
-#pragma endregion
 
-#pragma region Graph Functions
 /// <summary>
-/// Function to create a new graph
+/// Function to get the position of a cell along a Hilbert curve filling a square of side a power of two
 /// </summary>
-/// <param name="initialSize"></param>
+/// <param name="side"></param>
+/// <param name="x"></param>
+/// <param name="y"></param>
 /// <returns></returns>
-Graph* createGraph(int initialSize)
+static long long hilbertIndex(long long side, long long x, long long y)
 {
-    // Allocate memory for the graph
-    Graph* g = malloc(sizeof(Graph));
-
-    // Check if memory allocation was successful
-    if (!g)
+    long long d = 0;
+    for (long long s = side / 2; s > 0; s /= 2)
     {
-        perror("Failed to allocate memory for graph");
-        exit(EXIT_FAILURE);
-    }
-
-    // Allocate memory for the array of vertices
-    g->vertices = malloc(initialSize * sizeof(Node*));
+        int rx = (x & s) > 0;
+        int ry = (y & s) > 0;
+        d += s * s * ((3 * rx) ^ ry);
 
-    // Check if memory allocation was successful
-    if (!g->vertices)
-    {
-        free(g); // Clean up previously allocated graph memory before exiting
-        perror("Failed to allocate memory for vertices");
-        exit(EXIT_FAILURE);
+        // Rotate the quadrant so the curve inside it starts and ends where it should
+        if (ry == 0)
+        {
+            if (rx == 1)
+            {
+                x = side - 1 - x;
+                y = side - 1 - y;
+            }
+            long long temp = x;
+            x = y;
+            y = temp;
+        }
     }
+    return d;
+}
 
-    g->numVertices = 0;
-    g->size = initialSize;
+/// <summary>
+/// Struct to represent a vertex with its position along a space filling curve
+/// </summary>
+typedef struct
+{
+    long long key;
+    int vertex;
+} CurvePosition;
 
-    return g;
+/// <summary>
+/// Function to compare two vertices by their position along a curve, for qsort
+/// </summary>
+/// <param name="a"></param>
+/// <param name="b"></param>
+/// <returns></returns>
+static int compareCurvePositions(const void* a, const void* b)
+{
+    const CurvePosition* x = a;
+    const CurvePosition* y = b;
+    return (x->key > y->key) - (x->key < y->key);
 }
 
 /// <summary>
-/// Function to free the memory allocated for the graph
+/// Function to number the cells of a grid graph along a Hilbert curve, so that cells close in the matrix get close ids
 /// </summary>
 /// <param name="g"></param>
-void freeGraph(Graph* g)
+/// <param name="order">Receives the vertices in their new order</param>
+/// <returns>Number of vertices placed</returns>
+static int hilbertOrder(Graph* g, int order[])
 {
-    // Free the memory allocated for each vertex
-    for (int i = 0; i < g->numVertices; i++)
+    int n = g->numVertices;
+    long long side = 1;
+    while (side < g->numRows || side < g->numCols) side *= 2;
+
+    CurvePosition* cells = malloc((n > 0 ? n : 1) * sizeof(CurvePosition));
+    if (!cells)
     {
-        free(g->vertices[i]->adjacents);
-        free(g->vertices[i]);
+        perror("Failed to allocate memory for reordering");
+        exit(EXIT_FAILURE);
+    }
+    for (int v = 0; v < n; v++)
+    {
+        cells[v].key = hilbertIndex(side, v % g->numCols, v / g->numCols);
+        cells[v].vertex = v;
+    }
+    qsort(cells, n, sizeof(CurvePosition), compareCurvePositions);
+    for (int i = 0; i < n; i++)
+    {
+        order[i] = cells[i].vertex;
     }
 
-    free(g->vertices);
-    free(g);
+    free(cells);
+    return n;
 }
 
 /// <summary>
-/// Function to load a graph from a file
+/// Function to renumber the vertices of a graph so that the vertices a search visits one after the other sit close
+/// together in memory. Removed vertices are dropped, the start to end order and the adjacency order are kept, and the
+/// storage is rebuilt contiguously: a graph of nodes gets new nodes in the new order, the other forms are frozen.
 /// </summary>
 /// <param name="g"></param>
-/// <param name="filename"></param>
-void loadMatrixFromFile(Graph* g, const char* filename)
+/// <param name="strategy"></param>
+/// <returns>Array giving the new id of each old id (-1 for removed vertices), to be freed by the caller, or NULL if
+/// the strategy does not apply to the graph</returns>
+int* reorderGraph(Graph* g, ReorderStrategy strategy)
 {
-    // Open the file
-    FILE* file = fopen(filename, "r");
+    if (strategy == REORDER_HILBERT && g->storage != STORAGE_GRID)
+    {
+        printf("The Hilbert order needs a graph loaded as a grid.\n");
+        return NULL;
+    }
 
-    // Check if the file was opened successfully
-    if (!file)
+    double start = statsPhaseBegin();
+    int n = g->numVertices;
+    int* order = malloc((n > 0 ? n : 1) * sizeof(int));
+    int* map = malloc((n > 0 ? n : 1) * sizeof(int));
+    uint64_t* placed = createVisitedSet(n);
+
+    // Check if memory allocation was successful
+    if (!order || !map || !placed)
     {
-        perror("File not found");
+        perror("Failed to allocate memory for reordering");
         exit(EXIT_FAILURE);
     }
 
-    // Read the file line by line
-    char line[1024];
-    int vertexId = 0;
-    int numRows = 0;
-    int numCols = 0;
+    int count;
+    if (strategy == REORDER_HILBERT)
+    {
+        count = hilbertOrder(g, order);
+    }
+    else if (strategy == REORDER_RCM)
+    {
+        buildReverseIndex(g);
+        count = rcmOrder(g, order, placed);
+    }
+    else
+    {
+        count = bfsOrder(g, order, placed);
+    }
+    free(placed);
+
+    for (int v = 0; v < n; v++)
+    {
+        map[v] = -1;
+    }
+    for (int i = 0; i < count; i++)
+    {
+        map[order[i]] = i;
+    }
 
-    // Count the number of columns
-    if (fgets(line, sizeof(line), file))
+    // Copy the values and adjacency lists in the new order
+    int numEdges = 0;
+    for (int i = 0; i < count; i++)
+    {
+        numEdges += vertexDegree(g, order[i]);
+    }
+    int* offsets = malloc((count + 1) * sizeof(int));
+    int* targets = malloc((numEdges > 0 ? numEdges : 1) * sizeof(int));
+    int* values = malloc((count > 0 ? count : 1) * sizeof(int));
+    if (!offsets || !targets || !values)
     {
-        char* token = strtok(line, ";");
+        perror("Failed to allocate memory for reordering");
+        exit(EXIT_FAILURE);
+    }
 
-        while (token)
+    int edge = 0;
+    for (int i = 0; i < count; i++)
+    {
+        int v = order[i];
+        int numAdj = vertexDegree(g, v);
+        offsets[i] = edge;
+        values[i] = vertexValue(g, v);
+        for (int j = 0; j < numAdj; j++)
         {
-            numCols++;
-            token = strtok(NULL, ";");
+            targets[edge++] = map[vertexAdjacent(g, v, j)];
         }
     }
-    // Return to the beginning of the file
-    rewind(file);
+    offsets[count] = edge;
 
-    // Get the number of rows and add the vertices to the graph
-    while (fgets(line, sizeof(line), file))
+    // The start to end order only needs a slot table when it is no longer the id order
+    SlotTable* slots = NULL;
+    int expected = 0;
+    for (int v = firstVertex(g); v >= 0 && map[v] == expected; v = nextVertex(g, v))
+    {
+        expected++;
+    }
+    if (expected < count)
     {
-        numRows++;
-        char* token = strtok(line, ";");
+        slots = calloc(1, sizeof(SlotTable));
+        if (!slots)
+        {
+            perror("Failed to allocate memory for slots");
+            exit(EXIT_FAILURE);
+        }
+        reserveSlots(slots, count);
 
-        // Add the vertices to the graph
-        while (token)
+        int prev = -1;
+        for (int v = firstVertex(g); v >= 0; v = nextVertex(g, v))
         {
-            int value;
-            sscanf(token, "%d", &value);
-            addVertex(g, value);
-            token = strtok(NULL, ";");
+            int id = map[v];
+            slots->generation[id] = 0;
+            slots->prev[id] = prev;
+            if (prev >= 0) slots->next[prev] = id;
+            else slots->first = id;
+            prev = id;
         }
+        slots->next[prev] = -1;
+        slots->last = prev;
+        slots->freeList = -1;
+        slots->numFree = 0;
     }
-    fclose(file);
 
-    // Canno't create a connection between the vertices in diagonal
-    // Connect the vertices in the graph
-    for (int i = 0; i < g->numVertices; i++)
+    // Replace the old storage
+    bool wasNodes = g->storage == STORAGE_NODES;
+    invalidateHighestSumCache(g);
+    invalidatePathTables(g);
+    if (wasNodes) arenaRelease(&g->arena);
+    else releaseArrays(g);
+    freeSlots(g->slots);
+
+    g->slots = slots;
+    g->offsets = offsets;
+    g->targets = targets;
+    g->values = values;
+    g->numVertices = count;
+    g->numRows = 0;
+    g->numCols = 0;
+    g->storage = STORAGE_FROZEN;
+    g->wavefrontStart = -1;
+
+    // Nodes are laid out in id order when they are recreated
+    if (wasNodes) thawGraph(g);
+    statsPhaseEnd(PHASE_BUILD, start);
+
+    free(order);
+    return map;
+}
+#pragma endregion
+
+#pragma region DFS
+/// <summary>
+/// Function to backtrack through the graph using DFS (Depth First Search).
+/// The path is kept on a heap stack of frames, so long paths do not overflow the native stack.
+/// </summary>
+/// <param name="g"></param>
+/// <param name="v"></param>
+/// <param name="visited">Visited set from createVisitedSet</param>
+/// <param name="path"></param>
+/// <param name="pathIndex"></param>
+/// <param name="maxSum"></param>
+/// <param name="currentSum"></param>
+/// <param name="bestPath"></param>
+/// <param name="bestPathLen"></param>
+void dfsBacktraking(Graph* g, int v, uint64_t visited[], int path[], int* pathIndex, int* maxSum, int currentSum, int bestPath[], int* bestPathLen)
+{
+    SearchFrame* frames = createSearchFrames(g);
+    int depth = 0;
+
+    while (v >= 0 || depth > 0)
     {
-        int row = i / numCols;
-        int col = i % numCols;
+        if (v >= 0)
+        {
+            // Mark the vertex as visited and add it to the path
+            markVisited(visited, v);
+            path[(*pathIndex)++] = v;
+            currentSum += vertexValue(g, v);
+            statsExpand(searchStats, *pathIndex);
 
-        // Connect to the right
-        if (col < numCols - 1)
+            // If the current sum is greater than the maximum sum, update the maximum sum
+            if (currentSum > *maxSum)
+            {
+                *maxSum = currentSum;
+                *bestPathLen = *pathIndex;
+                memcpy(bestPath, path, (*pathIndex) * sizeof(int));
+                statsImprovement(searchStats, currentSum);
+            }
+
+            frames[depth++] = (SearchFrame){ v, 0, vertexDegree(g, v), currentSum, false };
+            v = -1;
+            continue;
+        }
+
+        // Visit the next unvisited adjacent vertex of the last vertex on the path
+        SearchFrame* f = &frames[depth - 1];
+        while (f->next < f->numAdj)
         {
-            addEdge(g, i, i + 1);
+            int adj = vertexAdjacent(g, f->vertex, f->next++);
+            if (!isVisited(visited, adj))
+            {
+                v = adj;
+                break;
+            }
+            statsBacktrack(searchStats, 1);
         }
-        // Connect to the bottom
-        if (row < numRows - 1)
+        if (v >= 0)
         {
-            addEdge(g, i, i + numCols);
+            f->extended = true;
+            currentSum = f->sum;
+            continue;
         }
+
+        // Backtrack
+        if (!f->extended) statsPathCompleted(searchStats);
+        clearVisited(visited, f->vertex);
+        (*pathIndex)--;
+        depth--;
+        currentSum = depth > 0 ? frames[depth - 1].sum : 0;
     }
+
+    free(frames);
 }
 
 /// <summary>
-/// Function to generate a DOT file from a graph, highlighting the best path in red
+/// Function to find the highest sum path in a graph using DFS (Depth First Search).
+/// Acyclic graphs and grids are solved by dynamic programming instead. It gives the same sum, but when several paths
+/// tie it returns the one ending first in the topological order (see dagHighestSum), not the first one the search
+/// reaches, so tied matrices can show a different path than the backtracking search.
 /// </summary>
 /// <param name="g"></param>
-/// <param name="filename"></param>
-void generateDotFile(Graph* g, const char* filename, int bestPath[], int bestPathLen)
+/// <param name="startVertex"></param>
+/// <param name="maxSum"></param>
+/// <param name="bestPath"></param>
+/// <param name="bestPathLen"></param>
+void dfs(Graph* g, int startVertex, int* maxSum, int bestPath[], int* bestPathLen)
 {
-    // Open the file
-    FILE* file = fopen(filename, "w");
+    double start = statsPhaseBegin();
+    double build = searchStats ? searchStats->phaseTime[PHASE_BUILD] : 0;
+    statsSearchStarted(searchStats, "dag");
 
-    // Check if the file was opened successfully
-    if (!file)
+    // Matrix grids are solved by the wavefront kernel, see MAX_CACHED_GRID
+    bool solved = false;
+    if (g->storage == STORAGE_GRID && !(g->cache && g->cache->startVertex == startVertex) &&
+        (g->wavefrontStart != startVertex || g->numVertices > MAX_CACHED_GRID))
     {
-        perror("Unable to create file");
-        exit(EXIT_FAILURE);
+        g->wavefrontStart = startVertex;
+        solved = gridHighestSumParallel(g, startVertex, maxSum, bestPath, bestPathLen, g->numVertices >= MIN_PARALLEL_GRID ? 0 : 1);
     }
 
-    // Write the graph to the file
-    fprintf(file, "digraph G {\n");
-
-    // Output all vertices
-    for (int i = 0; i < g->numVertices; i++)
+    // Other acyclic graphs are solved in linear time, and after value updates only the affected part is recomputed;
+    // backtracking is only needed with cycles
+    if (!solved && !cachedHighestSum(g, startVertex, maxSum, bestPath, bestPathLen))
     {
-        fprintf(file, "    %d [label=\"%d\"];\n", g->vertices[i]->id, g->vertices[i]->value);
+        // With several processors, split the backtracking search over all of them
+        if (cpuCount() > 1)
+        {
+            dfsParallel(g, startVertex, maxSum, bestPath, bestPathLen, 0);
+        }
+        else
+        {
+            statsSearchStarted(searchStats, "backtracking");
+
+            // Create a set to keep track of visited vertices
+            uint64_t* visited = createVisitedSet(g->numVertices);
+            int* path = malloc(g->numVertices * sizeof(int));
+            int pathIndex = 0;
+            *maxSum = 0;
+            *bestPathLen = 0;
+
+            // Start the DFS from the given vertex
+            dfsBacktraking(g, startVertex, visited, path, &pathIndex, maxSum, 0, bestPath, bestPathLen);
+
+            // Free the memory allocated for the visited set
+            free(visited);
+            free(path);
+        }
     }
 
-    // Output all edges with special color for the best path
-    for (int i = 0; i < g->numVertices; i++)
+    // Building the highest sum tables was already counted as build time
+    if (searchStats)
     {
-        for (int j = 0; j < g->vertices[i]->numAdj; j++)
-        {
-            int isBestPath = 0;
-            for (int k = 0; k < bestPathLen - 1; k++)
-            {
-                if (bestPath[k] == i && bestPath[k + 1] == g->vertices[i]->adjacents[j]->id)
-                {
-                    isBestPath = 1;
-                    break;
-                }
-            }
-            if (isBestPath)
-                fprintf(file, "    %d -> %d [color=red];\n", i, g->vertices[i]->adjacents[j]->id);
-            else
-                fprintf(file, "    %d -> %d;\n", i, g->vertices[i]->adjacents[j]->id);
-        }
+        statsPhaseEnd(PHASE_SEARCH, start);
+        searchStats->phaseTime[PHASE_SEARCH] -= searchStats->phaseTime[PHASE_BUILD] - build;
     }
+}
+
+/// <summary>
+/// Struct to represent a walk over all the paths from a source to a destination, one path at a time. The search
+/// keeps its stack between calls, so it can be stopped and resumed at any path.
+/// </summary>
+typedef struct
+{
+    Graph* g;
+    int dest;
+    uint64_t* visited;
+    SearchFrame* frames;
+    int* path;        // Ids of the vertices on the current path, one per frame
+    int depth;
+    int next;         // Vertex to add to the path on the next step, or -1 to try the next adjacent vertex
+    long long skip;   // Paths still to pass over before the first one is returned
+    long long limit;  // Paths still to return, or -1 for all of them
+} PathIterator;
+
+/// <summary>
+/// Function called with each path of a walk; it returns false to stop the walk
+/// </summary>
+typedef bool (*PathSink)(void* context, const int path[], int pathLen, int sum);
+
+/// <summary>
+/// Function to start a walk over all the paths from a source to a destination, in the order allPaths prints them
+/// </summary>
+/// <param name="it"></param>
+/// <param name="g"></param>
+/// <param name="startVertex"></param>
+/// <param name="endVertex"></param>
+/// <param name="offset">Number of paths to pass over first</param>
+/// <param name="limit">Largest number of paths to return, or -1 for all of them</param>
+void pathIterBegin(PathIterator* it, Graph* g, int startVertex, int endVertex, long long offset, long long limit)
+{
+    it->g = g;
+    it->dest = endVertex;
+    it->visited = createVisitedSet(g->numVertices);
+    it->frames = createSearchFrames(g);
+    it->path = malloc((g->numVertices > 0 ? g->numVertices : 1) * sizeof(int));
+    it->depth = 0;
+    it->next = vertexExists(g, startVertex) ? startVertex : -1;
+    it->skip = offset > 0 ? offset : 0;
+    it->limit = limit;
 
-    fprintf(file, "}\n");
-    fclose(file);
+    // Check if memory allocation was successful
+    if (!it->path)
+    {
+        perror("Failed to allocate memory for path");
+        exit(EXIT_FAILURE);
+    }
 }
 
 /// <summary>
-/// Function to print the graph to the console
+/// Function to find the next path of a walk. Like dfsBacktraking, the path is kept on a heap stack of frames
+/// instead of the native stack; nothing is allocated.
 /// </summary>
-/// <param name="g">Pointer to the graph</param>
-void printGraph(Graph* g)
+/// <param name="it"></param>
+/// <param name="path">Set to the ids of the vertices on the path, valid until the next call</param>
+/// <param name="pathLen"></param>
+/// <param name="sum"></param>
+/// <returns>true if a path was found, false once there are no more paths or the limit was reached</returns>
+bool pathIterNext(PathIterator* it, const int** path, int* pathLen, int* sum)
 {
-    // Print each vertex and its adjacent vertices
-    for (int i = 0; i < g->numVertices; i++)
-    {
-        // Get the vertex
-        Node* vertex = g->vertices[i];
-        printf("Vertex %d (Value %d): ", vertex->id + 1, vertex->value);
+    Graph* g = it->g;
 
-        // Print the adjacent vertices
-        if (vertex->numAdj > 0)
+    while (it->limit != 0 && (it->next >= 0 || it->depth > 0))
+    {
+        if (it->next >= 0)
         {
-            printf("-> ");
-            for (int j = 0; j < vertex->numAdj; j++)
+            // Mark the vertex as visited and add it to the path
+            int v = it->next;
+            int currentSum = (it->depth > 0 ? it->frames[it->depth - 1].sum : 0) + vertexValue(g, v);
+            markVisited(it->visited, v);
+            it->path[it->depth] = v;
+            it->next = -1;
+            statsExpand(searchStats, it->depth + 1);
+
+            // The destination ends the path; it is not followed any further
+            bool reached = v == it->dest;
+            it->frames[it->depth++] = (SearchFrame){ v, 0, reached ? 0 : vertexDegree(g, v), currentSum, false };
+            if (!reached) continue;
+
+            statsPathCompleted(searchStats);
+            if (it->skip > 0)
             {
-                Node* adjVertex = vertex->adjacents[j];
-                printf("%d (Value %d)", adjVertex->id + 1, adjVertex->value);
-                if (j < vertex->numAdj - 1)
-                    printf(", ");
+                it->skip--;
+                continue;
             }
+            if (it->limit > 0) it->limit--;
+            *path = it->path;
+            *pathLen = it->depth;
+            *sum = currentSum;
+            return true;
         }
-        else
+
+        // Visit the next unvisited adjacent vertex of the last vertex on the path
+        SearchFrame* f = &it->frames[it->depth - 1];
+        while (f->next < f->numAdj)
         {
-            printf("No connections");
+            int adj = vertexAdjacent(g, f->vertex, f->next++);
+            if (!isVisited(it->visited, adj))
+            {
+                it->next = adj;
+                break;
+            }
+            statsBacktrack(searchStats, 1);
         }
-        printf("\n");
+        if (it->next >= 0) continue;
+
+        // Mark the vertex as unvisited
+        clearVisited(it->visited, f->vertex);
+        it->depth--;
     }
+
+    return false;
 }
-#pragma endregion
 
-#pragma region DFS
 /// <summary>
-/// Function to backtrack through the graph using DFS (Depth First Search)
+/// Function to pass the remaining paths of a walk to a sink
 /// </summary>
-/// <param name="g"></param>
-/// <param name="v"></param>
-/// <param name="visited"></param>
-/// <param name="path"></param>
-/// <param name="pathIndex"></param>
-/// <param name="maxSum"></param>
-/// <param name="currentSum"></param>
-/// <param name="bestPath"></param>
-/// <param name="bestPathLen"></param>
-void dfsBacktraking(Graph* g, int v, int visited[], int path[], int* pathIndex, int* maxSum, int currentSum, int bestPath[], int* bestPathLen)
+/// <param name="it"></param>
+/// <param name="sink"></param>
+/// <param name="context">Passed to the sink with each path</param>
+/// <returns>Number of paths passed to the sink</returns>
+long long pathIterDrain(PathIterator* it, PathSink sink, void* context)
 {
-    // Mark the current vertex as visited and add it to the path
-    visited[v] = 1;
-    path[(*pathIndex)++] = v;
-    currentSum += g->vertices[v]->value;
+    const int* path;
+    int pathLen, sum;
+    long long count = 0;
 
-    // If the current sum is greater than the maximum sum, update the maximum sum
-    if (currentSum > *maxSum)
+    while (pathIterNext(it, &path, &pathLen, &sum))
     {
-        *maxSum = currentSum;
-        *bestPathLen = *pathIndex;
-        memcpy(bestPath, path, (*pathIndex) * sizeof(int));
+        count++;
+        if (!sink(context, path, pathLen, sum)) break;
     }
+    return count;
+}
+
+/// <summary>
+/// Function to release a walk over paths
+/// </summary>
+/// <param name="it"></param>
+void pathIterEnd(PathIterator* it)
+{
+    free(it->visited);
+    free(it->frames);
+    free(it->path);
+    it->visited = NULL;
+    it->frames = NULL;
+    it->path = NULL;
+}
+
+/// <summary>
+/// Struct to represent where a path sink formats the paths to
+/// </summary>
+typedef struct
+{
+    OutputBuffer* ob;
+    const Graph* g;
+} PathPrinter;
 
-    // Recursively visit the adjacent vertices
-    for (int i = 0; i < g->vertices[v]->numAdj; i++)
+/// <summary>
+/// Path sink that formats the values of the path and its sum, the format of allPaths
+/// </summary>
+/// <param name="context">A PathPrinter</param>
+/// <param name="path"></param>
+/// <param name="pathLen"></param>
+/// <param name="sum"></param>
+/// <returns>false once writing fails</returns>
+bool printPathValues(void* context, const int path[], int pathLen, int sum)
+{
+    PathPrinter* p = context;
+    for (int i = 0; i < pathLen; i++)
     {
-        int adj = g->vertices[v]->adjacents[i]->id;
-        if (!visited[adj]) {
-            dfsBacktraking(g, adj, visited, path, pathIndex, maxSum, currentSum, bestPath, bestPathLen);
-        }
+        outputInt(p->ob, vertexValue(p->g, path[i]));
+        outputText(p->ob, " -> ");
     }
+    outputText(p->ob, "(Soma: ");
+    outputInt(p->ob, sum);
+    outputText(p->ob, ")\n");
+    return !p->ob->failed;
+}
+
+/// <summary>
+/// Function to find and print to a file all paths from a source to a destination using DFS
+/// </summary>
+/// <param name="g"></param>
+/// <param name="startVertex"></param>
+/// <param name="endVertex"></param>
+/// <param name="out"></param>
+void allPathsToFile(Graph* g, int startVertex, int endVertex, FILE* out)
+{
+    OutputBuffer ob;
+    PathPrinter printer = { &ob, g };
+    PathIterator it;
 
-    // Backtrack
-    visited[v] = 0;
-    (*pathIndex)--;
+    // Print all paths from the start vertex to the end vertex
+    outputBegin(&ob, out);
+    outputText(&ob, "All paths from ");
+    outputInt(&ob, startVertex + 1);
+    outputText(&ob, " to ");
+    outputInt(&ob, endVertex + 1);
+    outputText(&ob, ":\n");
+    double start = statsPhaseBegin();
+    statsSearchStarted(searchStats, "all-paths");
+    pathIterBegin(&it, g, startVertex, endVertex, 0, -1);
+    pathIterDrain(&it, printPathValues, &printer);
+    pathIterEnd(&it);
+    statsPhaseEnd(PHASE_SEARCH, start);
+    outputEnd(&ob);
 }
 
 /// <summary>
-/// Function to find the highest sum path in a graph using DFS (Depth First Search)
+/// Function to find and print all paths from a source to a destination using DFS
 /// </summary>
 /// <param name="g"></param>
 /// <param name="startVertex"></param>
-/// <param name="maxSum"></param>
-/// <param name="bestPath"></param>
-/// <param name="bestPathLen"></param>
-void dfs(Graph* g, int startVertex, int* maxSum, int bestPath[], int* bestPathLen)
+/// <param name="endVertex"></param>
+void allPaths(Graph* g, int startVertex, int endVertex)
 {
-    // Create an array to keep track of visited vertices
-    int* visited = calloc(g->numVertices, sizeof(int));
-    int* path = malloc(g->numVertices * sizeof(int));
-    int pathIndex = 0;
-    *maxSum = 0;
-    *bestPathLen = 0;
+    allPathsToFile(g, startVertex, endVertex, stdout);
+}
+#pragma endregion
 
-    // Start the DFS from the given vertex
-    dfsBacktraking(g, startVertex, visited, path, &pathIndex, maxSum, 0, bestPath, bestPathLen);
+#pragma region Batch Mode
+// Commands read by runBatch, one per line; vertex ids are 1-based as in the menu, and '#' starts a comment.
+// Each command writes one result line, or "error <line number> <message>" without stopping the script:
+//   update <vertex> <value>            ok
+//   addstart <value>, addend <value>   vertex <id>
+//   addedge <from> <to>                ok
+//   removeedge <from> <to>             ok
+//   removevertex <vertex>              ok
+//   vertices                           vertices <count>
+//   highest [<start>]                  highest <sum> <id> <id> ...
+//   highest bounded [<start>]          highest <sum> <id> <id> ..., then pruned <subtrees cut>; backtracking with
+//                                      branch-and-bound, for graphs with cycles
+//   best <from> <to>                   best <sum> <id> <id> ...
+//   paths [<from> <to>]                paths <count> [<lowest> <highest> <mean>] [overflow]
+//   topk <k> [<from> <to>]             topk <n>, followed by n lines "path <sum> <id> <id> ..."
+//   allpaths [<from> <to> [<offset> <limit>]]
+//                                      one line "path <sum> <id> <id> ..." per path, then allpaths <n>
+//   save <file>, dot <file>            ok
+//   reorder bfs|rcm|hilbert            ok, the vertices get new ids in that order
+//   stats on, stats off                ok
+//   stats                              stats solver <name> expanded <n> backtracks <n> depth <n> completed <n>
+//                                      improvements <n> load <s> build <s> search <s> export <s>
+// Queries default to the first and last vertices of the graph. While the statistics are on, each query
+// is followed by the stats line of that query. A query whose results do not fit in memory fails with
+// "out of memory"; topk on an acyclic graph asks for at most as many paths as there are.
+#define BATCH_LINE_SIZE 4096
 
-    // Free the memory allocated for the visited array
-    free(visited);
-    free(path);
+/// <summary>
+/// Function to write the error result of a batch command
+/// </summary>
+/// <param name="ob"></param>
+/// <param name="lineNumber"></param>
+/// <param name="message"></param>
+static void batchError(OutputBuffer* ob, int lineNumber, const char* message)
+{
+    outputText(ob, "error ");
+    outputInt(ob, lineNumber);
+    outputText(ob, " ");
+    outputText(ob, message);
+    outputText(ob, "\n");
 }
 
 /// <summary>
-/// Function to perform DFS and store all paths from source to destination
+/// Function to write a path as 1-based vertex ids, each preceded by a space
 /// </summary>
-/// <param name="g"></param>
-/// <param name="v"></param>
-/// <param name="dest"></param>
-/// <param name="visited"></param>
+/// <param name="ob"></param>
 /// <param name="path"></param>
-/// <param name="pathIndex"></param>
-void allPathsDFS(Graph* g, int v, int dest, int visited[], int path[], int pathIndex, int currentSum)
+/// <param name="pathLen"></param>
+static void batchPath(OutputBuffer* ob, const int path[], int pathLen)
 {
-    // Mark the current vertex as visited and add it to the path
-    visited[v] = 1;
-    path[pathIndex++] = g->vertices[v]->value;
-    currentSum += g->vertices[v]->value;
-
-    // If the destination vertex is reached, print the path
-    if (v == dest)
+    for (int i = 0; i < pathLen; i++)
     {
-        // Print the path
-        for (int i = 0; i < pathIndex; i++)
-        {
-            printf("%d -> ", path[i]);
-        }
-        printf("(Soma: %d)\n", currentSum);
+        outputText(ob, " ");
+        outputInt(ob, path[i] + 1);
     }
-    // Otherwise, recursively visit the adjacent vertices
-    else
+    outputText(ob, "\n");
+}
+
+/// <summary>
+/// Path sink that writes the path as a batch result line
+/// </summary>
+/// <param name="context">The OutputBuffer of the batch</param>
+/// <param name="path"></param>
+/// <param name="pathLen"></param>
+/// <param name="sum"></param>
+/// <returns>false once writing fails</returns>
+static bool batchPathSink(void* context, const int path[], int pathLen, int sum)
+{
+    OutputBuffer* ob = context;
+    outputText(ob, "path ");
+    outputInt(ob, sum);
+    batchPath(ob, path, pathLen);
+    return !ob->failed;
+}
+
+/// <summary>
+/// Function to write the statistics of the last query as one line
+/// </summary>
+/// <param name="ob"></param>
+/// <param name="s"></param>
+static void batchStats(OutputBuffer* ob, const SearchStats* s)
+{
+    static const char* phaseNames[NUM_PHASES] = { "load", "build", "search", "export" };
+    char seconds[32];
+
+    outputText(ob, "stats solver ");
+    outputText(ob, s->solver);
+    outputText(ob, " expanded ");
+    outputInt(ob, s->expanded);
+    outputText(ob, " backtracks ");
+    outputInt(ob, s->backtracks);
+    outputText(ob, " depth ");
+    outputInt(ob, s->maxDepth);
+    outputText(ob, " completed ");
+    outputInt(ob, s->pathsCompleted);
+    outputText(ob, " improvements ");
+    outputInt(ob, s->improvements);
+    for (int p = 0; p < NUM_PHASES; p++)
     {
-        // Recursively visit the adjacent vertices
-        for (int i = 0; i < g->vertices[v]->numAdj; i++)
-        {
-            // Get the adjacent vertex
-            int adj = g->vertices[v]->adjacents[i]->id;
-            if (!visited[adj])
-            {
-                // Recursively visit the adjacent vertex
-                allPathsDFS(g, adj, dest, visited, path, pathIndex, currentSum);
-            }
-        }
+        snprintf(seconds, sizeof(seconds), " %s %.6f", phaseNames[p], s->phaseTime[p]);
+        outputText(ob, seconds);
     }
-
-    // Mark the current vertex as unvisited
-    visited[v] = 0;
-    pathIndex--;
-    currentSum -= g->vertices[v]->value;
+    outputText(ob, "\n");
 }
 
 /// <summary>
-/// Function to find and print all paths from a source to a destination using DFS
+/// Function to run a script of commands on a graph without any user interaction or external process,
+/// writing one machine-readable result line per command
 /// </summary>
 /// <param name="g"></param>
-/// <param name="startVertex"></param>
-/// <param name="endVertex"></param>
-void allPaths(Graph* g, int startVertex, int endVertex)
+/// <param name="script"></param>
+/// <param name="out"></param>
+/// <param name="queryStats">Statistics used by the stats command, holding the time taken to load the graph</param>
+/// <returns>Number of commands that failed</returns>
+int runBatch(Graph* g, FILE* script, FILE* out, SearchStats* queryStats)
 {
-    int* visited = calloc(g->numVertices, sizeof(int));
-    int* path = malloc(g->numVertices * sizeof(int));
-    int pathIndex = 0;
-    int currentSum = 0;
+    OutputBuffer ob;
+    outputBegin(&ob, out);
 
-    // Print all paths from the start vertex to the end vertex
-    printf("All paths from %d to %d:\n", startVertex + 1, endVertex + 1);
-    allPathsDFS(g, startVertex, endVertex, visited, path, pathIndex, currentSum);
+    char line[BATCH_LINE_SIZE];
+    int lineNumber = 0, errors = 0;
+    int* paths = NULL;   // Room for the paths of the last query
+    int* sums = NULL;
+    int* pathLens = NULL;
 
-    // Free the memory allocated for the visited array
-    free(visited);
-    free(path);
+    while (fgets(line, sizeof(line), script))
+    {
+        lineNumber++;
+
+        // Drop the comment, then skip blank lines
+        char* comment = strchr(line, '#');
+        if (comment) *comment = '\0';
+
+        char command[32], name[BATCH_LINE_SIZE];
+        int args[4];
+        int numArgs = sscanf(line, "%31s %d %d %d %d", command, &args[0], &args[1], &args[2], &args[3]) - 1;
+        if (numArgs < 0) continue;
+
+        // Turn the 1-based ids into vertex ids; the arguments that are values are used as read
+        int a = numArgs >= 1 ? args[0] - 1 : -1;
+        int b = numArgs >= 2 ? args[1] - 1 : -1;
+        int from = firstVertex(g), to = lastVertex(g);
+        const char* error = NULL;
+
+        if (strcmp(command, "update") == 0)
+        {
+            if (numArgs < 2) error = "usage: update <vertex> <value>";
+            else if (!vertexExists(g, a)) error = "invalid vertex";
+            else
+            {
+                updateVertexValue(g, a, args[1]);
+                outputText(&ob, "ok\n");
+            }
+        }
+        else if (strcmp(command, "addstart") == 0 || strcmp(command, "addend") == 0)
+        {
+            bool atStart = command[3] == 's';
+            if (numArgs < 1) error = atStart ? "usage: addstart <value>" : "usage: addend <value>";
+            else
+            {
+                if (atStart) addVertexAtStart(g, args[0]);
+                else addVertexAtEnd(g, args[0]);
+                outputText(&ob, "vertex ");
+                outputInt(&ob, (atStart ? firstVertex(g) : lastVertex(g)) + 1);
+                outputText(&ob, "\n");
+            }
+        }
+        else if (strcmp(command, "addedge") == 0 || strcmp(command, "removeedge") == 0)
+        {
+            bool add = command[0] == 'a';
+            if (numArgs < 2) error = add ? "usage: addedge <from> <to>" : "usage: removeedge <from> <to>";
+            else if (!vertexExists(g, a) || !vertexExists(g, b)) error = "invalid vertex";
+            else if (add)
+            {
+                addEdge(g, a, b);
+                outputText(&ob, "ok\n");
+            }
+            else if (!removeEdge(g, a, b)) error = "no edge";
+            else outputText(&ob, "ok\n");
+        }
+        else if (strcmp(command, "removevertex") == 0)
+        {
+            if (numArgs < 1) error = "usage: removevertex <vertex>";
+            else if (!vertexExists(g, a)) error = "invalid vertex";
+            else
+            {
+                removeVertex(g, a);
+                outputText(&ob, "ok\n");
+            }
+        }
+        else if (strcmp(command, "vertices") == 0)
+        {
+            outputText(&ob, "vertices ");
+            outputInt(&ob, vertexCount(g));
+            outputText(&ob, "\n");
+        }
+        else if (strcmp(command, "allpaths") == 0)
+        {
+            if (numArgs >= 2)
+            {
+                from = a;
+                to = b;
+            }
+            if (numArgs == 1 || numArgs == 3) error = "usage: allpaths [<from> <to> [<offset> <limit>]]";
+            else if (!vertexExists(g, from) || !vertexExists(g, to)) error = "invalid vertex";
+            else
+            {
+                if (searchStats) resetSearchStats(searchStats);
+                freezeGraph(g);
+                double start = statsPhaseBegin();
+                statsSearchStarted(searchStats, "all-paths");
+
+                PathIterator it;
+                pathIterBegin(&it, g, from, to, numArgs >= 4 ? args[2] : 0, numArgs >= 4 ? args[3] : -1);
+                long long count = pathIterDrain(&it, batchPathSink, &ob);
+                pathIterEnd(&it);
+                statsPhaseEnd(PHASE_SEARCH, start);
+
+                outputText(&ob, "allpaths ");
+                outputInt(&ob, count);
+                outputText(&ob, "\n");
+                if (searchStats) batchStats(&ob, searchStats);
+            }
+        }
+        else if (strcmp(command, "best") == 0)
+        {
+            if (numArgs < 2) error = "usage: best <from> <to>";
+            else if (!vertexExists(g, a) || !vertexExists(g, b)) error = "invalid vertex";
+            else
+            {
+                if (searchStats) resetSearchStats(searchStats);
+                int* temp = realloc(paths, g->numVertices * sizeof(int));
+                if (temp) paths = temp;
+
+                int sum, pathLen;
+                if (!temp) error = "out of memory";
+                else if (!bestPathBetween(g, a, b, &sum, paths, &pathLen)) error = "no path";
+                else
+                {
+                    outputText(&ob, "best ");
+                    outputInt(&ob, sum);
+                    batchPath(&ob, paths, pathLen);
+                }
+                if (searchStats && !error) batchStats(&ob, searchStats);
+            }
+        }
+        else if (strcmp(command, "highest") == 0 && sscanf(line, "%*s %31s", name) == 1 && strcmp(name, "bounded") == 0)
+        {
+            // The start vertex follows the mode
+            if (sscanf(line, "%*s %*s %d", &args[0]) == 1) from = args[0] - 1;
+            if (!vertexExists(g, from)) error = "invalid vertex";
+            else
+            {
+                int* temp = realloc(paths, g->numVertices * sizeof(int));
+                if (temp) paths = temp;
+                if (!temp) error = "out of memory";
+                else
+                {
+                    if (searchStats) resetSearchStats(searchStats);
+                    freezeGraph(g);
+                    int sum, pathLen;
+                    long long pruned;
+                    dfsBounded(g, from, &sum, paths, &pathLen, &pruned);
+                    outputText(&ob, "highest ");
+                    outputInt(&ob, sum);
+                    batchPath(&ob, paths, pathLen);
+                    outputText(&ob, "pruned ");
+                    outputInt(&ob, pruned);
+                    outputText(&ob, "\n");
+                    if (searchStats) batchStats(&ob, searchStats);
+                }
+            }
+        }
+        else if (strcmp(command, "highest") == 0 || strcmp(command, "paths") == 0 || strcmp(command, "topk") == 0)
+        {
+            bool topk = command[0] == 't';
+            int k = topk && numArgs >= 1 ? args[0] : 1;
+            if (topk)
+            {
+                // The endpoints follow k
+                a = numArgs >= 2 ? args[1] - 1 : -1;
+                b = numArgs >= 3 ? args[2] - 1 : -1;
+            }
+            if (command[0] == 'h' && numArgs >= 1) from = a;
+            if (command[0] != 'h' && numArgs >= (topk ? 3 : 2))
+            {
+                from = a;
+                to = b;
+            }
+
+            // Queries run on the frozen form. An acyclic graph cannot give more paths than it has.
+            if (topk && k > 0 && vertexExists(g, from) && vertexExists(g, to))
+            {
+                PathCount count;
+                freezeGraph(g);
+                if (countPaths(g, from, to, &count) && count.high == 0 && count.low < (uint64_t)k)
+                {
+                    k = count.low > 0 ? (int)count.low : 1;
+                }
+            }
+
+            if (topk && (numArgs < 1 || k <= 0)) error = "usage: topk <k> [<from> <to>]";
+            else if (!vertexExists(g, from) || (command[0] != 'h' && !vertexExists(g, to))) error = "invalid vertex";
+            else
+            {
+                // The results can hold k paths of every vertex
+                size_t room = (size_t)k * g->numVertices;
+                int* tempPaths = room <= SIZE_MAX / sizeof(int) ? realloc(paths, room * sizeof(int)) : NULL;
+                if (tempPaths) paths = tempPaths;
+                int* tempSums = tempPaths ? realloc(sums, k * sizeof(int)) : NULL;
+                if (tempSums) sums = tempSums;
+                int* tempLens = tempSums ? realloc(pathLens, k * sizeof(int)) : NULL;
+                if (tempLens) pathLens = tempLens;
+                if (!tempLens) error = "out of memory";
+            }
+
+            if (!error)
+            {
+                // The search needs memory in proportion to k too; write the results so far in case it runs out
+                if (topk) outputFlush(&ob);
+                if (searchStats) resetSearchStats(searchStats);
+                freezeGraph(g);
+
+                if (command[0] == 'h')
+                {
+                    dfs(g, from, &sums[0], paths, &pathLens[0]);
+                    outputText(&ob, "highest ");
+                    outputInt(&ob, sums[0]);
+                    batchPath(&ob, paths, pathLens[0]);
+                }
+                else if (topk)
+                {
+                    int found = topKPaths(g, from, to, k, sums, paths, pathLens);
+                    outputText(&ob, "topk ");
+                    outputInt(&ob, found);
+                    outputText(&ob, "\n");
+                    for (int r = 0; r < found; r++)
+                    {
+                        outputText(&ob, "path ");
+                        outputInt(&ob, sums[r]);
+                        batchPath(&ob, paths + (size_t)r * g->numVertices, pathLens[r]);
+                    }
+                }
+                else
+                {
+                    PathStats stats;
+                    if (!pathStatistics(g, from, to, &stats, NULL, 0)) error = "cyclic graph";
+                    else
+                    {
+                        char count[40], mean[64];
+                        formatPathCount(stats.count, count);
+                        outputText(&ob, "paths ");
+                        outputText(&ob, count);
+                        if (stats.count.high != 0 || stats.count.low != 0)
+                        {
+                            snprintf(mean, sizeof(mean), "%.2f", stats.meanSum);
+                            outputText(&ob, " ");
+                            outputInt(&ob, stats.minSum);
+                            outputText(&ob, " ");
+                            outputInt(&ob, stats.maxSum);
+                            outputText(&ob, " ");
+                            outputText(&ob, mean);
+                        }
+                        outputText(&ob, stats.overflow ? " overflow\n" : "\n");
+                    }
+                }
+                if (searchStats && !error) batchStats(&ob, searchStats);
+            }
+        }
+        else if (strcmp(command, "save") == 0 || strcmp(command, "dot") == 0)
+        {
+            // Take the rest of the line as the file name
+            if (sscanf(line, "%*s %[^\r\n]", name) != 1) error = command[0] == 's' ? "usage: save <file>" : "usage: dot <file>";
+            else if (command[0] == 's' && !saveGraphBinary(g, name)) error = "save failed";
+            else
+            {
+                if (command[0] == 'd') generateDotFile(g, name, NULL, 0);
+                outputText(&ob, "ok\n");
+            }
+        }
+        else if (strcmp(command, "reorder") == 0)
+        {
+            int* map = NULL;
+            if (sscanf(line, "%*s %31s", name) != 1) error = "usage: reorder bfs|rcm|hilbert";
+            else if (strcmp(name, "bfs") == 0) map = reorderGraph(g, REORDER_BFS);
+            else if (strcmp(name, "rcm") == 0) map = reorderGraph(g, REORDER_RCM);
+            else if (strcmp(name, "hilbert") != 0) error = "usage: reorder bfs|rcm|hilbert";
+            else if (g->storage != STORAGE_GRID) error = "not a grid";
+            else map = reorderGraph(g, REORDER_HILBERT);
+
+            if (map) outputText(&ob, "ok\n");
+            free(map);
+        }
+        else if (strcmp(command, "stats") == 0)
+        {
+            if (sscanf(line, "%*s %31s", name) != 1) batchStats(&ob, queryStats);
+            else if (strcmp(name, "on") == 0 || strcmp(name, "off") == 0)
+            {
+                searchStats = name[1] == 'n' ? queryStats : NULL;
+                outputText(&ob, "ok\n");
+            }
+            else error = "usage: stats [on|off]";
+        }
+        else
+        {
+            error = "unknown command";
+        }
+
+        if (error)
+        {
+            batchError(&ob, lineNumber, error);
+            errors++;
+        }
+    }
+
+    free(paths);
+    free(sums);
+    free(pathLens);
+    searchStats = NULL;
+    outputEnd(&ob);
+    fflush(out);
+    return errors;
 }
 #pragma endregion
 
+// Programs that reuse the graph code, such as the benchmark, define GRAPH_NO_MAIN before including this file
+#ifndef GRAPH_NO_MAIN
 #pragma region Main
+// Menu option 6 only lists the paths one by one up to this many
+#define MAX_LISTED_PATHS 1000
+
 /// <summary>
 /// Main function
 /// </summary>
 /// <returns></returns>
-int main()
+int main(int argc, char* argv[])
 {
     // Create a graph
     Graph* graph = createGraph(1);
+
+    // Statistics of the last query; they are only collected while turned on, but the load is always timed
+    SearchStats queryStats = { 0 };
+    resetSearchStats(&queryStats);
+    double loadStart = wallClock();
+
+    // Without loading the matrix: TP_EDA --stream <matrix file> [<start row> <start column>], printing the highest
+    // sum path as the batch command highest does
+    if (argc >= 3 && strcmp(argv[1], "--stream") == 0)
+    {
+        GridCell start = { 0, 0 };
+        if (argc >= 5)
+        {
+            start.row = atoi(argv[3]) - 1;
+            start.col = atoi(argv[4]) - 1;
+        }
+
+        int maxSum, pathLen, numCols;
+        GridCell* path = streamHighestSum(argv[2], start, &maxSum, &pathLen, &numCols);
+        OutputBuffer ob;
+        outputBegin(&ob, stdout);
+        outputText(&ob, "highest ");
+        outputInt(&ob, maxSum);
+        for (int i = 0; i < pathLen; i++)
+        {
+            outputText(&ob, " ");
+            outputInt(&ob, (long long)path[i].row * numCols + path[i].col + 1);
+        }
+        outputText(&ob, "\n");
+        free(path);
+        freeGraph(graph);
+        return outputEnd(&ob) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    // Without the menu: TP_EDA --batch <matrix file> [<script file>, or - for the standard input]
+    if (argc >= 3 && strcmp(argv[1], "--batch") == 0)
+    {
+        loadMatrixAsGrid(graph, argv[2], STENCIL_RIGHT_DOWN);
+        queryStats.phaseTime[PHASE_LOAD] = wallClock() - loadStart;
+
+        FILE* script = argc >= 4 && strcmp(argv[3], "-") != 0 ? fopen(argv[3], "r") : stdin;
+        if (!script)
+        {
+            perror("Unable to open script file");
+            freeGraph(graph);
+            return EXIT_FAILURE;
+        }
+
+        int errors = runBatch(graph, script, stdout, &queryStats);
+        if (script != stdin) fclose(script);
+        freeGraph(graph);
+        return errors > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+
     int choice = 0, choice2 = 0, newValue, index, from, to, maxSum = 0, bestPathLen = 0;
-    int* bestPath = malloc(graph->numVertices * sizeof(int));
+    int* bestPath = NULL;
+    PathStats stats;
 
-    loadMatrixFromFile(graph, "Matrix.txt");
+    // Restore the graph saved by the last session, unless the matrix file was changed since
+    if (!isFileNewer("Graph.bin", "Matrix.txt") || !loadGraphBinary(graph, "Graph.bin"))
+    {
+        loadMatrixAsGrid(graph, "Matrix.txt", STENCIL_RIGHT_DOWN);
+    }
+    queryStats.phaseTime[PHASE_LOAD] = wallClock() - loadStart;
     generateDotFile(graph, "Graph.dot", NULL, 0);
     system("dot -Tpng Graph.dot -o Graph.png");
     system("start Graph.png");
@@ -659,6 +7195,7 @@ int main()
         printf("5. Remove Edge\n");
         printf("6. All Paths\n");
         printf("7. Highest Sum\n");
+        printf("8. Search Statistics (%s)\n", searchStats ? "on" : "off");
         printf("0. Exit\n");
         printf("Enter your choice: ");
         scanf("%d", &choice);
@@ -757,14 +7294,52 @@ int main()
             scanf("%d", &from);
             printf("To Vertex Index: ");
             scanf("%d", &to);
-            removeEdge(graph, from - 1, to - 1);
+            if (removeEdge(graph, from - 1, to - 1))
+            {
+                printf("Edge removed successfully from %d to %d.\n", from - 1, to - 1);
+            }
+            else if (vertexExists(graph, from - 1) && vertexExists(graph, to - 1))
+            {
+                printf("No edge found from %d to %d.\n", from - 1, to - 1);
+            }
             printf("\nEdge removed successfully.\n\n");
             printGraph(graph);
             break;
 
         case 6:
             system("cls");
-            allPaths(graph, 0, graph->numVertices - 1);
+            if (searchStats) resetSearchStats(searchStats);
+            freezeGraph(graph);
+
+            // On acyclic graphs the paths are counted first, and only listed when there are not too many
+            if (firstVertex(graph) < 0)
+            {
+                printf("The graph is empty.\n");
+            }
+            else if (pathStatistics(graph, firstVertex(graph), lastVertex(graph), &stats, NULL, 0))
+            {
+                char count[40];
+                formatPathCount(stats.count, count);
+                if (stats.count.high == 0 && stats.count.low <= MAX_LISTED_PATHS)
+                {
+                    allPaths(graph, firstVertex(graph), lastVertex(graph));
+                }
+                printf("\nPaths: %s%s\n", count, stats.overflow ? " (overflow)" : "");
+                if (stats.count.high != 0 || stats.count.low != 0)
+                {
+                    printf("Lowest sum: %d\nHighest sum: %d\nMean sum: %.2f\n", stats.minSum, stats.maxSum, stats.meanSum);
+                }
+            }
+            else
+            {
+                allPaths(graph, firstVertex(graph), lastVertex(graph));
+            }
+
+            if (searchStats)
+            {
+                printf("\n");
+                printSearchStats(searchStats, stdout);
+            }
             break;
 
         case 7:
@@ -772,7 +7347,23 @@ int main()
             printf("Graph:\n");
             printGraph(graph);
             printf("\n\n");
-            dfs(graph, 0, &maxSum, bestPath, &bestPathLen);
+
+            // The best path can hold every vertex, and the graph may have grown since the last search
+            int* temp = realloc(bestPath, (graph->numVertices > 0 ? graph->numVertices : 1) * sizeof(int));
+            if (!temp)
+            {
+                perror("Failed to allocate memory for the best path");
+                exit(EXIT_FAILURE);
+            }
+            bestPath = temp;
+            if (searchStats) resetSearchStats(searchStats);
+            freezeGraph(graph);
+            maxSum = 0;
+            bestPathLen = 0;
+            if (firstVertex(graph) >= 0)
+            {
+                dfs(graph, firstVertex(graph), &maxSum, bestPath, &bestPathLen);
+            }
 
             printf("Highest sum: %d\n", maxSum);
             printf("Path: ");
@@ -781,6 +7372,23 @@ int main()
                 printf("%d ", bestPath[i] + 1);
             }
             printf("\n");
+
+            if (searchStats)
+            {
+                printf("\n");
+                printSearchStats(searchStats, stdout);
+            }
+            break;
+
+        case 8:
+            // Collect the statistics of options 6 and 7, or stop collecting them
+            system("cls");
+            searchStats = searchStats ? NULL : &queryStats;
+            printf("Search statistics are %s.\n", searchStats ? "on" : "off");
+            if (searchStats)
+            {
+                printSearchStats(searchStats, stdout);
+            }
             break;
 
         case 0:
@@ -794,10 +7402,18 @@ int main()
         default:
             printf("Invalid choice. Please try again.\n");
         }
+
+        // Keep the snapshot in sync with the edits
+        if (choice >= 1 && choice <= 5)
+        {
+            saveGraphBinary(graph, "Graph.bin");
+        }
     } while (choice != 0);
 
     // Free the memory allocated for the graph
     freeGraph(graph);
+    free(bestPath);
     return 0;
 }
-#pragma endregion
\ No newline at end of file
+#pragma endregion
+#endif